@@ -4,12 +4,34 @@ from esphome.const import *
 from esphome.components import climate
 from esphome.components import sensor
 from esphome.components import binary_sensor
+from esphome.components import text_sensor
+from esphome.components import web_server_base
+from esphome.components.esp32 import add_idf_sdkconfig_option
+from esphome import automation
 from esphome import pins
+from esphome.core import CORE
 
 openthermgw_ns = cg.esphome_ns.namespace("opentherm")
 OpenThermGWComponent = openthermgw_ns.class_("OpenThermGWClimate", cg.Component)
+OpenThermFrameLog = openthermgw_ns.class_("OpenThermFrameLog")
+OpenThermRamLogStorage = openthermgw_ns.class_("OpenThermRamLogStorage")
+OpenThermFlashLogStorage = openthermgw_ns.class_("OpenThermFlashLogStorage")
+OpenThermLineServer = openthermgw_ns.class_("OpenThermLineServer")
+OpenThermAggregator = openthermgw_ns.class_("OpenThermAggregator")
+OpenThermMqttBatch = openthermgw_ns.class_("OpenThermMqttBatch")
+OpenThermMetrics = openthermgw_ns.class_("OpenThermMetrics")
+DumpFrameLogAction = openthermgw_ns.class_("DumpFrameLogAction", automation.Action)
+
+
+def AUTO_LOAD():
+    auto_load = ["sensor", "climate", "binary_sensor", "text_sensor"]
+    # Only the line server needs sockets; loaded this early, the config is still raw.
+    config = (CORE.raw_config or {}).get("opentherm") or {}
+    if CONF_LINE_SERVER in config:
+        auto_load.append("socket")
+    return auto_load
+
 
-AUTO_LOAD = ["sensor", "climate", "binary_sensor"]
 CONF_HUB_ID = "opentherm"
 
 UNIT_HOURS = "h"
@@ -22,7 +44,17 @@ CONF_IS_DHW_ACTIVE = "is_dhw_active"
 CONF_IS_DIAGNOSTIC_EVENT = "is_diagnostic_event"
 CONF_IS_FAULT_INDICATION = "is_fault_indication"
 CONF_IS_FLAME_ON = "is_flame_on"
+CONF_IS_RESTORED_STALE = "is_restored_stale"
+CONF_IS_FAILOVER_ACTIVE = "is_failover_active"
+CONF_ISR_MAX_DURATION = "isr_max_duration"
+CONF_ISR_MAX_EDGE_ERROR = "isr_max_edge_error"
+CONF_FAILOVER_LATENCY = "failover_latency"
 CONF_BOILER_WATER_TEMP = "boiler_water_temp"
+CONF_BURNER_DUTY_CYCLE = "burner_duty_cycle"
+CONF_BURNER_HOURS = "burner_hours"
+CONF_CH_HOURS = "ch_hours"
+CONF_DHW_HOURS = "dhw_hours"
+CONF_FULL_LOAD_HOURS = "full_load_hours"
 CONF_BURNER_OPERATION_HOURS = "burner_operation_hours"
 CONF_BURNER_STARTS = "burner_starts"
 CONF_CH_PUMP_OPERATION_HOURS = "ch_pump_operation_hours"
@@ -46,37 +78,136 @@ CONF_THERMOSTAT_IN_PIN = "thermostat_in_pin"
 CONF_THERMOSTAT_OUT_PIN = "thermostat_out_pin"
 CONF_BOILER_IN_PIN = "boiler_in_pin"
 CONF_BOILER_OUT_PIN = "boiler_out_pin"
+CONF_PROTOCOL_TASK = "protocol_task"
+CONF_PASSIVE = "passive"
+CONF_BACKEND = "backend"
+CONF_LIGHT_SLEEP = "light_sleep"
+CONF_AWAKE_RATIO = "awake_ratio"
+CONF_WAKE_MARGIN = "wake_margin"
+CONF_BUS_PROFILE = "bus_profile"
+CONF_THERMOSTAT_BUS_LOAD = "thermostat_bus_load"
+CONF_BOILER_BUS_LOAD = "boiler_bus_load"
+CONF_POLLING_PROFILE = "polling_profile"
+CONF_MQTT_BATCH = "mqtt_batch"
+CONF_ENTITY_UPDATES = "entity_updates"
+CONF_METRICS = "metrics"
+CONF_FRAME_LOG = "frame_log"
+CONF_STORAGE = "storage"
+CONF_PARTITION = "partition"
+CONF_WARM_START = "warm_start"
+CONF_SAVE_INTERVAL = "save_interval"
+CONF_PUBLISH_INTERVAL = "publish_interval"
+CONF_PARAMETER_DOWNLOAD = "parameter_download"
+CONF_ADAPTIVE_POLLING = "adaptive_polling"
+CONF_ACTIVE_INTERVAL = "active_interval"
+CONF_IDLE_INTERVAL = "idle_interval"
+CONF_REFRESH_INTERVAL = "refresh_interval"
+CONF_TSP_VALUES = "tsp_values"
+CONF_FHB_VALUES = "fhb_values"
+CONF_FAILOVER = "failover"
+CONF_LINE_SERVER = "line_server"
+CONF_ENERGY_UPDATE_INTERVAL = "energy_update_interval"
+CONF_ISR_STATS = "isr_stats"
+CONF_WINDOW = "window"
+CONF_MEAN = "mean"
+CONF_LAST = "last"
+CONF_CONTROLLER = "controller"
+CONF_CONTROLLER_SETPOINT = "controller_setpoint"
+CONF_KP = "kp"
+CONF_KI = "ki"
+CONF_CURVE_SLOPE = "curve_slope"
+CONF_CURVE_OFFSET = "curve_offset"
+CONF_MIN_SETPOINT = "min_setpoint"
+CONF_MAX_SETPOINT = "max_setpoint"
+CONF_SETPOINT = "setpoint"
+
+FRAME_LOG_SECTOR_SIZE = 4096
 
 helper_opentherm_list = [
+    CONF_AWAKE_RATIO,
+    CONF_BOILER_BUS_LOAD,
     CONF_BOILER_WATER_TEMP,
+    CONF_BURNER_DUTY_CYCLE,
+    CONF_BURNER_HOURS,
     CONF_BURNER_OPERATION_HOURS,
     CONF_BURNER_STARTS,
+    CONF_CH_HOURS,
     CONF_CH_PUMP_OPERATION_HOURS,
     CONF_CH_PUMP_STARTS,
     CONF_CH_WATER_PRESSURE,
+    CONF_CONTROLLER_SETPOINT,
     CONF_DHW2_TEMPERATURE,
     CONF_DHW_BURNER_OPERATION_HOURS,
     CONF_DHW_BURNER_STARTS,
     CONF_DHW_FLOW_RATE,
+    CONF_DHW_HOURS,
     CONF_DHW_PUMP_VALVE_OPERATION_HOURS,
     CONF_DHW_PUMP_VALVE_STARTS,
     CONF_DHW_TEMPERATURE,
     CONF_EXHAUST_TEMPERATURE,
+    CONF_FAILOVER_LATENCY,
+    CONF_FULL_LOAD_HOURS,
     CONF_FLOW_TEMPERATURE_CH2,
     CONF_IS_CH2_ACTIVE,
     CONF_IS_CH_ACTIVE,
     CONF_IS_COOLING_ACTIVE,
     CONF_IS_DHW_ACTIVE,
     CONF_IS_DIAGNOSTIC_EVENT,
+    CONF_IS_FAILOVER_ACTIVE,
     CONF_IS_FAULT_INDICATION,
     CONF_IS_FLAME_ON,
+    CONF_IS_RESTORED_STALE,
+    CONF_ISR_MAX_DURATION,
+    CONF_ISR_MAX_EDGE_ERROR,
     CONF_OUTSIDE_AIR_TEMPERATURE,
     CONF_RELATIVE_MODULATION_LEVEL,
     CONF_RETURN_WATER_TEMPERATURE,
     CONF_SOLAR_COLLECTOR_TEMPERATURE,
     CONF_SOLAR_STORAGE_TEMPERATURE,
+    CONF_THERMOSTAT_BUS_LOAD,
+]
+
+def stats_schema(**kwargs):
+    value_schema = sensor.sensor_schema(**kwargs)
+    return cv.Schema(
+        {
+            cv.GenerateID(): cv.declare_id(OpenThermAggregator),
+            cv.Optional(CONF_WINDOW, default="5min"): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_MIN): value_schema,
+            cv.Optional(CONF_MAX): value_schema,
+            cv.Optional(CONF_MEAN): value_schema,
+            cv.Optional(CONF_LAST): value_schema,
+        }
+    )
+
+
+temperature_stats_schema = stats_schema(
+    device_class=DEVICE_CLASS_TEMPERATURE,
+    unit_of_measurement=UNIT_CELSIUS,
+    accuracy_decimals=1,
+    state_class=STATE_CLASS_MEASUREMENT,
+)
+
+# Windowed aggregates, configured as <sensor>_stats.
+opentherm_stats_list = [
+    CONF_BOILER_WATER_TEMP,
+    CONF_RETURN_WATER_TEMPERATURE,
+    CONF_RELATIVE_MODULATION_LEVEL,
 ]
 
+opentherm_stats_schemas = cv.Schema(
+    {
+        cv.Optional(CONF_BOILER_WATER_TEMP + "_stats"): temperature_stats_schema,
+        cv.Optional(CONF_RETURN_WATER_TEMPERATURE + "_stats"): temperature_stats_schema,
+        cv.Optional(CONF_RELATIVE_MODULATION_LEVEL + "_stats"): stats_schema(
+            icon=ICON_PERCENT,
+            unit_of_measurement=UNIT_PERCENT,
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+        ),
+    }
+)
+
 opentherm_sensors_schemas = cv.Schema(
     {
         cv.Optional(CONF_BOILER_WATER_TEMP): sensor.sensor_schema(
@@ -211,21 +342,310 @@ opentherm_sensors_schemas = cv.Schema(
         cv.Optional(CONF_IS_FLAME_ON): binary_sensor.binary_sensor_schema(
             device_class=DEVICE_CLASS_EMPTY
         ).extend(),
+        cv.Optional(CONF_IS_RESTORED_STALE): binary_sensor.binary_sensor_schema(
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+        ).extend(),
+        cv.Optional(CONF_IS_FAILOVER_ACTIVE): binary_sensor.binary_sensor_schema(
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+        ).extend(),
+        cv.Optional(CONF_BURNER_HOURS): sensor.sensor_schema(
+            unit_of_measurement=UNIT_HOURS,
+            accuracy_decimals=3,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+        ).extend(),
+        cv.Optional(CONF_CH_HOURS): sensor.sensor_schema(
+            unit_of_measurement=UNIT_HOURS,
+            accuracy_decimals=3,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+        ).extend(),
+        cv.Optional(CONF_DHW_HOURS): sensor.sensor_schema(
+            unit_of_measurement=UNIT_HOURS,
+            accuracy_decimals=3,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+        ).extend(),
+        cv.Optional(CONF_FULL_LOAD_HOURS): sensor.sensor_schema(
+            unit_of_measurement=UNIT_HOURS,
+            accuracy_decimals=3,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+        ).extend(),
+        cv.Optional(CONF_BURNER_DUTY_CYCLE): sensor.sensor_schema(
+            unit_of_measurement=UNIT_PERCENT,
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+        ).extend(),
+        cv.Optional(CONF_CONTROLLER_SETPOINT): sensor.sensor_schema(
+            device_class=DEVICE_CLASS_TEMPERATURE,
+            unit_of_measurement=UNIT_CELSIUS,
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+        ).extend(),
+        cv.Optional(CONF_ISR_MAX_DURATION): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MICROSECOND,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ).extend(),
+        # Spread of the ISR's mid-bit edge timestamps around 1 ms: interrupt latency
+        # jitter plus the sender's own timing error.
+        cv.Optional(CONF_ISR_MAX_EDGE_ERROR): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MICROSECOND,
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ).extend(),
+        cv.Optional(CONF_AWAKE_RATIO): sensor.sensor_schema(
+            unit_of_measurement=UNIT_PERCENT,
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ).extend(),
+        cv.Optional(CONF_THERMOSTAT_BUS_LOAD): sensor.sensor_schema(
+            unit_of_measurement=UNIT_PERCENT,
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ).extend(),
+        cv.Optional(CONF_BOILER_BUS_LOAD): sensor.sensor_schema(
+            unit_of_measurement=UNIT_PERCENT,
+            accuracy_decimals=1,
+            state_class=STATE_CLASS_MEASUREMENT,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ).extend(),
+        cv.Optional(CONF_FAILOVER_LATENCY): sensor.sensor_schema(
+            unit_of_measurement=UNIT_MILLISECOND,
+            accuracy_decimals=0,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ).extend(),
+        cv.Optional(CONF_TSP_VALUES): text_sensor.text_sensor_schema(
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+        ),
+        cv.Optional(CONF_FHB_VALUES): text_sensor.text_sensor_schema(
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+        ),
+        cv.Optional(CONF_POLLING_PROFILE): text_sensor.text_sensor_schema(
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC
+        ),
     }
 )
 
+
+def validate_protocol_task(config):
+    if config[CONF_PROTOCOL_TASK] and not (CORE.is_esp32 or CORE.is_host):
+        raise cv.Invalid(f"{CONF_PROTOCOL_TASK} is only supported on ESP32 and host")
+    return config
+
+
+def validate_backend(config):
+    if config[CONF_BACKEND] == "rmt":
+        if not CORE.is_esp32:
+            raise cv.Invalid(f"{CONF_BACKEND}: rmt is only supported on ESP32")
+        cv.require_framework_version(
+            esp_idf=cv.Version(5, 0, 0), esp32_arduino=cv.Version(3, 0, 0)
+        )(config)
+        if config[CONF_ISR_STATS]:
+            raise cv.Invalid(f"{CONF_ISR_STATS} is not available with {CONF_BACKEND}: rmt")
+    return config
+
+
+def validate_light_sleep(config):
+    if CONF_LIGHT_SLEEP not in config:
+        if CONF_AWAKE_RATIO in config:
+            raise cv.Invalid(f"{CONF_AWAKE_RATIO} requires {CONF_LIGHT_SLEEP}")
+        return config
+    if not CORE.is_esp32:
+        raise cv.Invalid(f"{CONF_LIGHT_SLEEP} is only supported on ESP32")
+    if config[CONF_PROTOCOL_TASK]:
+        raise cv.Invalid(f"{CONF_LIGHT_SLEEP} cannot be used with {CONF_PROTOCOL_TASK}")
+    if config[CONF_BACKEND] == "rmt":
+        raise cv.Invalid(f"{CONF_LIGHT_SLEEP} cannot be used with {CONF_BACKEND}: rmt")
+    if config[CONF_PASSIVE]:
+        raise cv.Invalid(
+            f"{CONF_LIGHT_SLEEP} cannot be used with {CONF_PASSIVE}, "
+            "the gateway does not see when the next request is due"
+        )
+    # Light sleep callbacks of the power management driver.
+    cv.require_framework_version(esp_idf=cv.Version(5, 3, 0))(config)
+    return config
+
+
+def validate_bus_profile(config):
+    if not config[CONF_BUS_PROFILE]:
+        for key in (CONF_THERMOSTAT_BUS_LOAD, CONF_BOILER_BUS_LOAD, CONF_POLLING_PROFILE):
+            if key in config:
+                raise cv.Invalid(f"{key} requires {CONF_BUS_PROFILE}: true")
+    return config
+
+
+def validate_isr_stats(config):
+    if not config[CONF_ISR_STATS]:
+        for key in (CONF_ISR_MAX_DURATION, CONF_ISR_MAX_EDGE_ERROR):
+            if key in config:
+                raise cv.Invalid(f"{key} requires {CONF_ISR_STATS}: true")
+    return config
+
+
+def validate_passive(config):
+    for key in (CONF_THERMOSTAT_OUT_PIN, CONF_BOILER_OUT_PIN):
+        if config[CONF_PASSIVE] and key in config:
+            raise cv.Invalid(f"{key} cannot be used with {CONF_PASSIVE}, the bus is never driven")
+        if not config[CONF_PASSIVE] and key not in config:
+            raise cv.Invalid(f"{key} is required unless {CONF_PASSIVE} is enabled")
+    return config
+
+
+def validate_log_size(value):
+    value = cv.int_range(min=2 * FRAME_LOG_SECTOR_SIZE)(value)
+    if value % FRAME_LOG_SECTOR_SIZE != 0:
+        raise cv.Invalid(f"Size must be a multiple of {FRAME_LOG_SECTOR_SIZE} bytes")
+    return value
+
+
+def validate_frame_log(config):
+    if config[CONF_STORAGE] == "flash" and not CORE.is_esp32:
+        raise cv.Invalid("Flash frame log storage is only supported on ESP32")
+    return config
+
+
+FRAME_LOG_SCHEMA = cv.All(
+    cv.Schema(
+        {
+            cv.Optional(CONF_STORAGE, default="ram"): cv.one_of("ram", "flash", lower=True),
+            # RAM only: allocated in PSRAM when available. Flash uses the partition size.
+            cv.Optional(CONF_SIZE, default=16 * 1024): validate_log_size,
+            cv.Optional(CONF_PARTITION, default="otlog"): cv.string,
+        }
+    ),
+    validate_frame_log,
+)
+
+
 CONFIG_SCHEMA = cv.All(
     cv.Schema(
         {
             cv.GenerateID(CONF_ID): cv.declare_id(OpenThermGWComponent),
             cv.Required(CONF_THERMOSTAT_IN_PIN): pins.internal_gpio_input_pin_schema,
-            cv.Required(CONF_THERMOSTAT_OUT_PIN): pins.internal_gpio_input_pin_schema,
+            cv.Optional(CONF_THERMOSTAT_OUT_PIN): pins.internal_gpio_input_pin_schema,
             cv.Required(CONF_BOILER_IN_PIN): pins.internal_gpio_input_pin_schema,
-            cv.Required(CONF_BOILER_OUT_PIN): pins.internal_gpio_input_pin_schema,
+            cv.Optional(CONF_BOILER_OUT_PIN): pins.internal_gpio_input_pin_schema,
+            cv.Optional(CONF_PROTOCOL_TASK, default=False): cv.boolean,
+            cv.Optional(CONF_PASSIVE, default=False): cv.boolean,
+            cv.Optional(CONF_BACKEND, default="gpio"): cv.one_of("gpio", "rmt", lower=True),
+            cv.Optional(CONF_FRAME_LOG): FRAME_LOG_SCHEMA,
+            # Publish once per bus cycle by default.
+            cv.Optional(
+                CONF_PUBLISH_INTERVAL, default="0s"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_ISR_STATS, default=False): cv.boolean,
+            cv.Optional(CONF_BUS_PROFILE, default=False): cv.boolean,
+            # Automatic light sleep while the bus is quiet. WiFi stays
+            # associated, but only sleeps with power_save_mode: light; the
+            # ethernet driver keeps the node awake.
+            cv.Optional(CONF_LIGHT_SLEEP): cv.Schema(
+                {
+                    cv.Optional(
+                        CONF_WAKE_MARGIN, default="50ms"
+                    ): cv.positive_time_period_milliseconds,
+                }
+            ),
+            cv.Optional(
+                CONF_ENERGY_UPDATE_INTERVAL, default="60s"
+            ): cv.positive_time_period_milliseconds,
+            cv.Optional(CONF_METRICS): cv.All(
+                cv.Schema(
+                    {
+                        cv.GenerateID(CONF_WEB_SERVER_BASE_ID): cv.use_id(
+                            web_server_base.WebServerBase
+                        ),
+                        cv.Optional(CONF_PATH, default="/metrics"): cv.string,
+                    }
+                ),
+                cv.requires_component("web_server_base"),
+            ),
+            cv.Optional(CONF_MQTT_BATCH): cv.All(
+                cv.Schema(
+                    {
+                        cv.Optional(CONF_TOPIC): cv.publish_topic,
+                        cv.Optional(CONF_QOS, default=0): cv.mqtt_qos,
+                        cv.Optional(CONF_RETAIN, default=False): cv.boolean,
+                        # Turn off to only send the batch. This stops the sensor updates
+                        # altogether: native API, web_server and on_value automations
+                        # no longer see new values either, not just MQTT.
+                        cv.Optional(CONF_ENTITY_UPDATES, default=True): cv.boolean,
+                    }
+                ),
+                cv.requires_component("mqtt"),
+            ),
+            cv.Optional(CONF_LINE_SERVER): cv.Schema(
+                {
+                    cv.Optional(CONF_PORT, default=25238): cv.port,
+                }
+            ),
+            cv.Optional(CONF_CONTROLLER): cv.Schema(
+                {
+                    cv.Optional(
+                        CONF_INTERVAL, default="10s"
+                    ): cv.positive_time_period_milliseconds,
+                    cv.Optional(CONF_KP, default=5.0): cv.float_,
+                    cv.Optional(CONF_KI, default=0.002): cv.float_,
+                    cv.Optional(CONF_CURVE_SLOPE, default=1.5): cv.float_,
+                    cv.Optional(CONF_CURVE_OFFSET, default=0.0): cv.float_,
+                    cv.Optional(CONF_MIN_SETPOINT, default=20): cv.float_range(
+                        min=10, max=90
+                    ),
+                    cv.Optional(CONF_MAX_SETPOINT, default=70): cv.float_range(
+                        min=10, max=90
+                    ),
+                }
+            ),
+            cv.Optional(CONF_FAILOVER): cv.Schema(
+                {
+                    cv.Optional(CONF_TIMEOUT, default="5s"): cv.All(
+                        cv.positive_time_period_milliseconds,
+                        cv.Range(min=cv.TimePeriod(seconds=2)),
+                    ),
+                    cv.Optional(CONF_SETPOINT, default=45): cv.float_range(
+                        min=10, max=90
+                    ),
+                }
+            ),
+            cv.Optional(CONF_ADAPTIVE_POLLING): cv.Schema(
+                {
+                    cv.Optional(
+                        CONF_ACTIVE_INTERVAL, default="2s"
+                    ): cv.positive_time_period_milliseconds,
+                    cv.Optional(
+                        CONF_IDLE_INTERVAL, default="60s"
+                    ): cv.positive_time_period_milliseconds,
+                }
+            ),
+            cv.Optional(CONF_PARAMETER_DOWNLOAD): cv.Schema(
+                {
+                    cv.Optional(
+                        CONF_INTERVAL, default="2s"
+                    ): cv.positive_time_period_milliseconds,
+                    cv.Optional(
+                        CONF_REFRESH_INTERVAL, default="1h"
+                    ): cv.positive_time_period_milliseconds,
+                }
+            ),
+            cv.Optional(CONF_WARM_START): cv.Schema(
+                {
+                    cv.Optional(
+                        CONF_SAVE_INTERVAL, default="10min"
+                    ): cv.positive_time_period_milliseconds,
+                }
+            ),
         }
     )
     .extend(opentherm_sensors_schemas)
-    .extend(cv.COMPONENT_SCHEMA)
+    .extend(opentherm_stats_schemas)
+    .extend(cv.COMPONENT_SCHEMA),
+    validate_protocol_task,
+    validate_passive,
+    validate_isr_stats,
+    validate_backend,
+    validate_light_sleep,
+    validate_bus_profile,
 )
 
 
@@ -235,12 +655,87 @@ def to_code(config):
 
     thermostat_in_pin = yield cg.gpio_pin_expression(config[CONF_THERMOSTAT_IN_PIN])
     cg.add(var.set_thermostat_in_pin(thermostat_in_pin))
-    thermostat_out_pin = yield cg.gpio_pin_expression(config[CONF_THERMOSTAT_OUT_PIN])
-    cg.add(var.set_thermostat_out_pin(thermostat_out_pin))
+    if CONF_THERMOSTAT_OUT_PIN in config:
+        thermostat_out_pin = yield cg.gpio_pin_expression(config[CONF_THERMOSTAT_OUT_PIN])
+        cg.add(var.set_thermostat_out_pin(thermostat_out_pin))
     boiler_in_pin = yield cg.gpio_pin_expression(config[CONF_BOILER_IN_PIN])
     cg.add(var.set_boiler_in_pin(boiler_in_pin))
-    boiler_out_pin = yield cg.gpio_pin_expression(config[CONF_BOILER_OUT_PIN])
-    cg.add(var.set_boiler_out_pin(boiler_out_pin))
+    if CONF_BOILER_OUT_PIN in config:
+        boiler_out_pin = yield cg.gpio_pin_expression(config[CONF_BOILER_OUT_PIN])
+        cg.add(var.set_boiler_out_pin(boiler_out_pin))
+    cg.add(var.set_protocol_task(config[CONF_PROTOCOL_TASK]))
+    if config[CONF_ISR_STATS]:
+        cg.add_define("USE_OPENTHERM_ISR_STATS")
+    if config[CONF_BUS_PROFILE]:
+        cg.add_define("USE_OPENTHERM_BUS_PROFILE")
+    cg.add(var.set_passive(config[CONF_PASSIVE]))
+    if config[CONF_BACKEND] == "rmt":
+        cg.add_define("USE_OPENTHERM_RMT")
+    if CONF_LIGHT_SLEEP in config:
+        cg.add_define("USE_OPENTHERM_LIGHT_SLEEP")
+        cg.add(var.set_light_sleep(config[CONF_LIGHT_SLEEP][CONF_WAKE_MARGIN]))
+        add_idf_sdkconfig_option("CONFIG_PM_ENABLE", True)
+        add_idf_sdkconfig_option("CONFIG_FREERTOS_USE_TICKLESS_IDLE", True)
+        add_idf_sdkconfig_option("CONFIG_PM_LIGHT_SLEEP_CALLBACKS", True)
+    if CONF_FRAME_LOG in config:
+        conf = config[CONF_FRAME_LOG]
+        if conf[CONF_STORAGE] == "flash":
+            storage = OpenThermFlashLogStorage.new(conf[CONF_PARTITION])
+        else:
+            storage = OpenThermRamLogStorage.new(conf[CONF_SIZE])
+        cg.add(var.set_frame_log(OpenThermFrameLog.new(storage)))
+    cg.add(var.set_publish_interval(config[CONF_PUBLISH_INTERVAL]))
+    energy_sensors = (
+        CONF_BURNER_HOURS,
+        CONF_CH_HOURS,
+        CONF_DHW_HOURS,
+        CONF_FULL_LOAD_HOURS,
+        CONF_BURNER_DUTY_CYCLE,
+    )
+    if any(k in config for k in energy_sensors):
+        cg.add(var.set_energy_interval(config[CONF_ENERGY_UPDATE_INTERVAL]))
+    if CONF_LINE_SERVER in config:
+        cg.add_define("USE_OPENTHERM_LINE_SERVER")
+        server = OpenThermLineServer.new(config[CONF_LINE_SERVER][CONF_PORT])
+        cg.add(var.set_line_server(server))
+    if CONF_METRICS in config:
+        conf = config[CONF_METRICS]
+        cg.add_define("USE_OPENTHERM_METRICS")
+        base = yield cg.get_variable(conf[CONF_WEB_SERVER_BASE_ID])
+        cg.add(var.set_metrics(OpenThermMetrics.new(base, conf[CONF_PATH])))
+    if CONF_MQTT_BATCH in config:
+        conf = config[CONF_MQTT_BATCH]
+        cg.add_define("USE_OPENTHERM_MQTT_BATCH")
+        batch = OpenThermMqttBatch.new(
+            conf.get(CONF_TOPIC, ""), conf[CONF_QOS], conf[CONF_RETAIN]
+        )
+        cg.add(var.set_mqtt_batch(batch, conf[CONF_ENTITY_UPDATES]))
+    if CONF_CONTROLLER in config:
+        conf = config[CONF_CONTROLLER]
+        cg.add(var.set_controller(conf[CONF_INTERVAL]))
+        controller = var.Pget_controller()
+        cg.add(controller.set_gains(conf[CONF_KP], conf[CONF_KI]))
+        cg.add(controller.set_curve(conf[CONF_CURVE_SLOPE], conf[CONF_CURVE_OFFSET]))
+        cg.add(controller.set_limits(conf[CONF_MIN_SETPOINT], conf[CONF_MAX_SETPOINT]))
+    if CONF_FAILOVER in config:
+        conf = config[CONF_FAILOVER]
+        cg.add(var.set_failover(conf[CONF_TIMEOUT], conf[CONF_SETPOINT]))
+    if CONF_ADAPTIVE_POLLING in config:
+        conf = config[CONF_ADAPTIVE_POLLING]
+        cg.add(
+            var.set_adaptive_polling(conf[CONF_ACTIVE_INTERVAL], conf[CONF_IDLE_INTERVAL])
+        )
+    if CONF_PARAMETER_DOWNLOAD in config:
+        conf = config[CONF_PARAMETER_DOWNLOAD]
+        cg.add(
+            var.set_parameter_download(conf[CONF_INTERVAL], conf[CONF_REFRESH_INTERVAL])
+        )
+    for k in (CONF_TSP_VALUES, CONF_FHB_VALUES, CONF_POLLING_PROFILE):
+        if k in config:
+            sens = yield text_sensor.new_text_sensor(config[k])
+            cg.add(getattr(var, "set_" + k)(sens))
+    if CONF_WARM_START in config:
+        cg.add(var.set_warm_start(config[CONF_WARM_START][CONF_SAVE_INTERVAL]))
     for k in helper_opentherm_list:
         if k in config:
             sens = None
@@ -251,4 +746,25 @@ def to_code(config):
             func = getattr(var, "set_" + k)
             cg.add(func(sens))
 
+    for k in opentherm_stats_list:
+        if k + "_stats" in config:
+            conf = config[k + "_stats"]
+            stats = cg.new_Pvariable(conf[CONF_ID], conf[CONF_WINDOW])
+            for key in (CONF_MIN, CONF_MAX, CONF_MEAN, CONF_LAST):
+                if key in conf:
+                    sens = yield sensor.new_sensor(conf[key])
+                    cg.add(getattr(stats, "set_" + key + "_sensor")(sens))
+            cg.add(getattr(var, "set_" + k + "_stats")(stats))
+
     cg.add(cg.App.register_climate(var))
+
+
+@automation.register_action(
+    "opentherm.dump_frame_log",
+    DumpFrameLogAction,
+    cv.Schema({cv.GenerateID(): cv.use_id(OpenThermGWComponent)}),
+)
+def dump_frame_log_to_code(config, action_id, template_arg, args):
+    paren = yield cg.get_variable(config[CONF_ID])
+    var = cg.new_Pvariable(action_id, template_arg, paren)
+    yield var
@@ -4,9 +4,26 @@ Copyright 2018, Ihor Melnyk */
 #include "opentherm.h"
 #include <esphome/core/helpers.h>
 
+#ifdef USE_OPENTHERM_LIGHT_SLEEP
+#include <driver/gpio.h>
+#include <esp_sleep.h>
+#endif
+
 namespace esphome {
 namespace opentherm {
 
+#ifdef USE_OPENTHERM_LIGHT_SLEEP
+// The stop bit's mid-bit edge comes 33.5 bit times after the start of the
+// frame, with 10% bit rate tolerance.
+static const uint32_t MAX_REPLAYED_FRAME_US = 37000;
+#endif
+
+#ifdef USE_OPENTHERM_BUS_PROFILE
+// A received frame is timestamped at the middle of its stop bit.
+static const uint32_t FRAME_BEFORE_STOP_US = 33500;
+static const uint32_t FRAME_AFTER_STOP_US = 500;
+#endif
+
 OpenThermChannel::OpenThermChannel(bool slave):
   isSlave(slave),
   store_(slave)
@@ -22,17 +39,38 @@ void OpenThermChannel::setup(std::function<void(uint32_t, OpenThermResponseStatu
   this->pin_in_->setup();
   this->store_.pin_in = this->pin_in_->to_isr();
 
-  this->pin_out_->setup();
-
+  // A passive channel never drives the bus, its output pin is left alone.
+  InternalGPIOPin *pin_out = this->store_.passive ? nullptr : this->pin_out_;
+  if (pin_out != nullptr)
+    pin_out->setup();
+
+#ifdef USE_OPENTHERM_ISR_STATS
+  this->store_.stats.cyclesPerUs = arch_get_cpu_freq_hz() / 1000000;
+#endif
+#ifdef USE_OPENTHERM_RMT
+  this->rmt_.setup(this->pin_in_, pin_out, &this->store_);
+#else
   this->pin_in_->attach_interrupt(OpenThermStore::gpio_intr, &this->store_, gpio::INTERRUPT_ANY_EDGE);
+#endif
 
-  activateBoiler();
+  if (pin_out != nullptr)
+    activateBoiler();
   this->store_.status = OpenThermStatus::READY;
   this->process_response_callback = callback;
 }
 
 void OpenThermChannel::loop()
 {
+#ifdef USE_OPENTHERM_RMT
+  if (!this->rmt_.is_armed())
+    this->rmt_.receive();
+#endif
+  // Nothing happened on the bus and no timeout is due: leave the ISR state alone.
+  uint32_t newTs = micros();
+  if (!this->store_.pending && (!this->deadlineArmed_ || (int32_t)(newTs - this->deadline_) < 0))
+    return;
+  this->store_.pending = false;
+
   OpenThermStatus st;
   uint32_t ts;
   {
@@ -41,9 +79,9 @@ void OpenThermChannel::loop()
     ts = this->store_.responseTimestamp;
   }
 
-  if (st == OpenThermStatus::READY) return;
-  uint32_t newTs = micros();
-  if (st != OpenThermStatus::NOT_INITIALIZED && (newTs - ts) > 1000000) {
+  this->deadlineArmed_ = false;
+  if (st == OpenThermStatus::READY || st == OpenThermStatus::NOT_INITIALIZED) return;
+  if ((newTs - ts) > 1000000) {
     this->store_.status = OpenThermStatus::READY;
     responseStatus = OpenThermResponseStatus::TIMEOUT;
     if (process_response_callback) {
@@ -59,6 +97,9 @@ void OpenThermChannel::loop()
   }
   else if (st == OpenThermStatus::RESPONSE_READY) {
     this->store_.status = OpenThermStatus::DELAY;
+#ifdef USE_OPENTHERM_BUS_PROFILE
+    this->profile_.frame(ts - FRAME_BEFORE_STOP_US, ts + FRAME_AFTER_STOP_US);
+#endif
     if (parity(this->store_.response))
       responseStatus = OpenThermResponseStatus::INVPARITY;
     else if (isSlave)
@@ -74,6 +115,28 @@ void OpenThermChannel::loop()
       this->store_.status = OpenThermStatus::READY;
     }
   }
+
+  st = this->store_.status;
+  if (st == OpenThermStatus::DELAY)
+    armDeadline(ts + 100000);
+  else if (st != OpenThermStatus::READY)
+    armDeadline(ts + 1000000);
+}
+
+void OpenThermChannel::armDeadline(uint32_t deadline)
+{
+  this->deadline_ = deadline;
+  this->deadlineArmed_ = true;
+}
+
+uint32_t OpenThermChannel::timeUntilDeadline()
+{
+  if (this->store_.pending)
+    return 0;
+  if (!this->deadlineArmed_)
+    return NO_DEADLINE;
+  int32_t remaining = (int32_t)(this->deadline_ - micros());
+  return remaining > 0 ? remaining : 0;
 }
 
 bool OpenThermChannel::isReady()
@@ -81,6 +144,11 @@ bool OpenThermChannel::isReady()
   return this->store_.status == OpenThermStatus::READY;
 }
 
+bool OpenThermChannel::isIdle()
+{
+  return !this->store_.pending && this->store_.status == OpenThermStatus::READY;
+}
+
 void OpenThermChannel::setActiveState() {
   this->pin_out_->digital_write(false);
 }
@@ -101,6 +169,26 @@ void OpenThermChannel::sendBit(bool high) {
   delayMicroseconds(500);
 }
 
+void OpenThermChannel::sendFrame(uint32_t frame)
+{
+#ifdef USE_OPENTHERM_BUS_PROFILE
+  uint32_t start = micros();
+#endif
+#ifdef USE_OPENTHERM_RMT
+  this->rmt_.transmit(frame);
+#else
+  sendBit(true); //start bit
+  for (int i = 31; i >= 0; i--) {
+    sendBit((frame & (1 << i)) != 0);
+  }
+  sendBit(true); //stop bit
+  setIdleState();
+#endif
+#ifdef USE_OPENTHERM_BUS_PROFILE
+  this->profile_.frame(start, micros());
+#endif
+}
+
 bool OpenThermChannel::sendRequestAync(uint32_t request)
 {
   bool ready;
@@ -116,24 +204,44 @@ bool OpenThermChannel::sendRequestAync(uint32_t request)
   this->store_.response = 0;
   responseStatus = OpenThermResponseStatus::NONE;
 
-  sendBit(true); //start bit
-  for (int i = 31; i >= 0; i--) {
-    sendBit((request & (1 << i)) != 0);
-  }
-  sendBit(true); //stop bit
-  setIdleState();
+  sendFrame(request);
 
   this->store_.status = OpenThermStatus::RESPONSE_WAITING;
   this->store_.responseTimestamp = micros();
+  armDeadline(this->store_.responseTimestamp + 1000000);
   return true;
 }
 
-uint32_t OpenThermChannel::sendRequest(uint32_t request)
+bool OpenThermChannel::waitReady(uint32_t timeout_ms)
 {
-  if (!sendRequestAync(request)) return 0;
+  uint32_t start = millis();
   while (!isReady()) {
+    if (millis() - start >= timeout_ms)
+      return false;
+    loop();
+    if (this->task_ != nullptr)
+      this->task_->wait(1);
+    else
+      yield();
+  }
+  return true;
+}
+
+// Returns as soon as the response has been received; the inter-frame delay
+// that follows is handled by loop(). Fails with TIMEOUT if the channel is
+// still busy with the previous exchange.
+uint32_t OpenThermChannel::sendRequest(uint32_t request)
+{
+  if (!sendRequestAync(request)) {
+    responseStatus = OpenThermResponseStatus::TIMEOUT;
+    return 0;
+  }
+  while (!isReady() && this->store_.status != OpenThermStatus::DELAY) {
     loop();
-    yield();
+    if (this->task_ != nullptr)
+      this->task_->wait(1);
+    else
+      yield();
   }
   return this->store_.response;
 }
@@ -144,13 +252,9 @@ bool OpenThermChannel::sendResponse(uint32_t request)
   this->store_.response = 0;
   responseStatus = OpenThermResponseStatus::NONE;
 
-  sendBit(true); //start bit
-  for (int i = 31; i >= 0; i--) {
-    sendBit((request & (1 << i)) != 0);
-  }
-  sendBit(true); //stop bit
-  setIdleState();
+  sendFrame(request);
   this->store_.status = OpenThermStatus::READY;
+  this->deadlineArmed_ = false;
   return true;
 }
 
@@ -159,11 +263,104 @@ OpenThermResponseStatus OpenThermChannel::getLastResponseStatus()
   return responseStatus;
 }
 
+#ifdef USE_OPENTHERM_ISR_STATS
+// No division in the ISR: bucket bounds are compared in cycles.
+void IRAM_ATTR OpenThermIsrStats::recordDuration(uint32_t cycles)
+{
+  this->calls++;
+  if (cycles < this->minDurationCycles)
+    this->minDurationCycles = cycles;
+  if (cycles > this->maxDurationCycles)
+    this->maxDurationCycles = cycles;
+  uint8_t bucket = 0;
+  while (bucket < BUCKETS - 1 && cycles >= (this->cyclesPerUs << bucket))
+    bucket++;
+  this->duration[bucket]++;
+}
+
+void IRAM_ATTR OpenThermIsrStats::recordEdge(uint32_t interval_us)
+{
+  uint32_t error = interval_us > 1000 ? interval_us - 1000 : 1000 - interval_us;
+  this->edges++;
+  if (error > this->maxEdgeErrorUs)
+    this->maxEdgeErrorUs = error;
+  uint32_t bucket = error / EDGE_BUCKET_US;
+  this->edgeError[bucket < BUCKETS ? bucket : BUCKETS - 1]++;
+}
+
+OpenThermIsrStats OpenThermChannel::takeIsrStats()
+{
+  InterruptLock lock;
+  OpenThermIsrStats stats = this->store_.stats;
+  this->store_.stats = OpenThermIsrStats();
+  this->store_.stats.cyclesPerUs = stats.cyclesPerUs;
+  if (stats.calls > 0) {
+    stats.minDurationUs = stats.minDurationCycles / stats.cyclesPerUs;
+    stats.maxDurationUs = stats.maxDurationCycles / stats.cyclesPerUs;
+  }
+  return stats;
+}
+#endif
+
+#ifdef USE_OPENTHERM_LIGHT_SLEEP
+void OpenThermChannel::enableWakeup()
+{
+  gpio_num_t pin = (gpio_num_t) this->pin_in_->get_pin();
+  gpio_intr_disable(pin);
+  // The input idles low, a start bit begins with a rising edge.
+  gpio_wakeup_enable(pin, this->pin_in_->is_inverted() ? GPIO_INTR_LOW_LEVEL : GPIO_INTR_HIGH_LEVEL);
+}
+
+bool OpenThermChannel::resumeFromSleep()
+{
+  gpio_num_t pin = (gpio_num_t) this->pin_in_->get_pin();
+  gpio_wakeup_disable(pin);
+
+  InterruptLock lock;
+  gpio_set_intr_type(pin, GPIO_INTR_ANYEDGE);
+  this->store_.pin_in.clear_interrupt();
+  // The rising edge of the start bit went by while the interrupt was off.
+  // As long as the first half of the start bit is still on the bus, replay
+  // it; the decoder then checks the mid-bit edge follows in time as usual.
+  bool started = this->store_.pin_in.digital_read();
+  if (started) {
+    OpenThermStore::gpio_intr(&this->store_);
+    started = this->store_.status == OpenThermStatus::RESPONSE_START_BIT;
+    this->store_.replayed = started;
+    this->store_.replayTimestamp = this->store_.responseTimestamp;
+  }
+  gpio_intr_enable(pin);
+  return started;
+}
+
+uint32_t OpenThermChannel::takeMissedStartBits()
+{
+  InterruptLock lock;
+  uint32_t missed = this->store_.missedStartBits;
+  this->store_.missedStartBits = 0;
+  return missed;
+}
+#endif
+
+static inline __attribute__((always_inline)) void decodeEdge(OpenThermStore *arg);
+
 void IRAM_ATTR OpenThermStore::gpio_intr(OpenThermStore *arg)
 {
+#ifdef USE_OPENTHERM_ISR_STATS
+  uint32_t start = arch_get_cpu_cycle_count();
+  decodeEdge(arg);
+  arg->stats.recordDuration(arch_get_cpu_cycle_count() - start);
+#else
+  decodeEdge(arg);
+#endif
+}
+
+static inline __attribute__((always_inline)) void decodeEdge(OpenThermStore *arg)
+{
+  const OpenThermStatus previous = arg->status;
   if (arg->status == OpenThermStatus::READY)
   {
-    if (!arg->isSlave && arg->pin_in.digital_read()) {
+    if ((!arg->isSlave || arg->passive) && arg->pin_in.digital_read()) {
        arg->status = OpenThermStatus::RESPONSE_WAITING;
     }
     else {
@@ -176,6 +373,9 @@ void IRAM_ATTR OpenThermStore::gpio_intr(OpenThermStore *arg)
     if (arg->pin_in.digital_read()) {
       arg->status = OpenThermStatus::RESPONSE_START_BIT;
       arg->responseTimestamp = newTs;
+#ifdef USE_OPENTHERM_LIGHT_SLEEP
+      arg->replayed = false;
+#endif
     }
     else {
       arg->status = OpenThermStatus::RESPONSE_INVALID;
@@ -195,6 +395,9 @@ void IRAM_ATTR OpenThermStore::gpio_intr(OpenThermStore *arg)
   }
   else if (arg->status == OpenThermStatus::RESPONSE_RECEIVING) {
     if ((newTs - arg->responseTimestamp) > 750) {
+#ifdef USE_OPENTHERM_ISR_STATS
+      arg->stats.recordEdge(newTs - arg->responseTimestamp);
+#endif
       if (arg->responseBitIndex < 32) {
         arg->response = (arg->response << 1) | !arg->pin_in.digital_read();
         arg->responseTimestamp = newTs;
@@ -202,71 +405,28 @@ void IRAM_ATTR OpenThermStore::gpio_intr(OpenThermStore *arg)
       }
       else { //stop bit
         arg->status = OpenThermStatus::RESPONSE_READY;
+#ifdef USE_OPENTHERM_LIGHT_SLEEP
+        // Started from a later bit, the frame only completes with edges of
+        // the next one, at least an inter-frame gap later.
+        if (arg->replayed && newTs - arg->replayTimestamp > MAX_REPLAYED_FRAME_US) {
+          arg->status = OpenThermStatus::RESPONSE_INVALID;
+          arg->missedStartBits++;
+        }
+        arg->replayed = false;
+#endif
         arg->responseTimestamp = newTs;
       }
     }
   }
-}
 
-bool parity(uint32_t frame) //odd parity
-{
-  uint8_t p = 0;
-  while (frame > 0)
-  {
-    if (frame & 1) p++;
-    frame = frame >> 1;
+  // Let loop() know the state machine moved, and wake the protocol task
+  // as soon as a frame has been completed.
+  if (arg->status != previous) {
+    arg->pending = true;
+    if (arg->task != nullptr &&
+        (arg->status == OpenThermStatus::RESPONSE_READY || arg->status == OpenThermStatus::RESPONSE_INVALID))
+      arg->task->notify_from_isr();
   }
-  return (p & 1);
-}
-
-OpenThermMessageType getMessageType(uint32_t message)
-{
-  OpenThermMessageType msg_type = static_cast<OpenThermMessageType>((message >> 28) & 7);
-  return msg_type;
-}
-
-OpenThermMessageID getDataID(uint32_t frame)
-{
-  return (OpenThermMessageID)((frame >> 16) & 0xFF);
-}
-
-uint32_t buildRequest(OpenThermMessageType type, OpenThermMessageID id, uint16_t data)
-{
-  uint32_t request = data;
-  if (type == OpenThermMessageType::WRITE_DATA) {
-    request |= 1ul << 28;
-  }
-  request |= ((uint32_t)id) << 16;
-  if (parity(request)) request |= (1ul << 31);
-  return request;
-}
-
-uint32_t buildResponse(OpenThermMessageType type, OpenThermMessageID id, uint16_t data)
-{
-  uint32_t response = data;
-  response |= type << 28;
-  response |= ((uint32_t)id) << 16;
-  if (parity(response)) response |= (1ul << 31);
-  return response;
-}
-
-uint32_t modifyMsgData(uint32_t msg, uint16_t data)
-{
-  msg = (msg & 0x7fff0000) | data;
-  if (parity(msg)) msg |= (1ul << 31);
-  return msg;
-}
-
-bool isValidResponse(uint32_t response)
-{
-  uint8_t msgType = (response << 1) >> 29;
-  return msgType == READ_ACK || msgType == WRITE_ACK || msgType == DATA_INVALID || msgType == UNKNOWN_DATA_ID;
-}
-
-bool isValidRequest(uint32_t request)
-{
-  uint8_t msgType = (request << 1) >> 29;
-  return msgType == READ_DATA || msgType == WRITE_DATA || msgType == INVALID_DATA;
 }
 
 const char *statusToString(OpenThermResponseStatus status)
@@ -282,57 +442,5 @@ const char *statusToString(OpenThermResponseStatus status)
   return "UNKNOWN";
 }
 
-const char *messageTypeToString(OpenThermMessageType message_type)
-{
-  switch (message_type) {
-    case READ_DATA:    return "READ_DATA";
-    case WRITE_DATA:    return "WRITE_DATA";
-    case INVALID_DATA:  return "INVALID_DATA";
-    case RESERVED:    return "RESERVED";
-    case READ_ACK:    return "READ_ACK";
-    case WRITE_ACK:    return "WRITE_ACK";
-    case DATA_INVALID:  return "DATA_INVALID";
-    case UNKNOWN_DATA_ID: return "UNKNOWN_DATA_ID";
-    default:        return "UNKNOWN";
-  }
-}
-
-uint8_t getUBUInt8(const uint32_t response) {
-  return (response >> 8) & 0xff;
-}
-
-uint8_t getLBUInt8(const uint32_t response) {
-  return response & 0xff;
-}
-
-int8_t getUBInt8(const uint32_t response) {
-  return (int8_t) ((response >> 8) & 0xff);
-}
-
-int8_t getLBInt8(const uint32_t response) {
-  return (int8_t) (response & 0xff);
-}
-
-uint16_t getUInt16(const uint32_t response) {
-  return response & 0xffff;
-}
-
-int16_t getInt16(const uint32_t response) {
-  return (int16_t) (response & 0xffff);
-}
-
-float getFloat(const uint32_t response) {
-  const uint16_t u88 = getUInt16(response);
-  const float f = (u88 & 0x8000) ? -(0x10000L - u88) / 256.0f : u88 / 256.0f;
-  return f;
-}
-
-uint16_t temperatureToData(float temperature) {
-  if (temperature < 0) temperature = 0;
-  if (temperature > 100) temperature = 100;
-  uint16_t data = (uint16_t)(temperature * 256);
-  return data;
-}
-
 }  // namespace opentherm
 }  // namespace esphome
@@ -0,0 +1,38 @@
+#include "opentherm_aggregator.h"
+
+namespace esphome {
+namespace opentherm {
+
+void OpenThermAggregator::add(float value)
+{
+  if (this->count_ == 0 || value < this->min_)
+    this->min_ = value;
+  if (this->count_ == 0 || value > this->max_)
+    this->max_ = value;
+  this->sum_ += value;
+  this->last_ = value;
+  this->count_++;
+}
+
+void OpenThermAggregator::loop(uint32_t now)
+{
+  if (now - this->start_ < this->window_)
+    return;
+  this->start_ = now;
+  if (this->count_ == 0)
+    return;
+
+  if (this->min_sensor_ != nullptr)
+    this->min_sensor_->publish_state(this->min_);
+  if (this->max_sensor_ != nullptr)
+    this->max_sensor_->publish_state(this->max_);
+  if (this->mean_sensor_ != nullptr)
+    this->mean_sensor_->publish_state(this->sum_ / this->count_);
+  if (this->last_sensor_ != nullptr)
+    this->last_sensor_->publish_state(this->last_);
+  this->count_ = 0;
+  this->sum_ = 0;
+}
+
+}  // namespace opentherm
+}  // namespace esphome
@@ -0,0 +1,46 @@
+#pragma once
+/*
+Streaming min/max/mean/last over a fixed time window.
+
+Samples are folded in as they are decoded; nothing is stored per sample. At
+the end of every window the results are published to whichever of the four
+sensors are configured and the aggregate starts over. Windows without
+samples publish nothing.
+*/
+
+#include <cstdint>
+#include "esphome/components/sensor/sensor.h"
+
+namespace esphome {
+namespace opentherm {
+
+class OpenThermAggregator {
+ public:
+  OpenThermAggregator(uint32_t window) : window_(window) {}
+
+  void set_min_sensor(sensor::Sensor *min_sensor) { this->min_sensor_ = min_sensor; }
+  void set_max_sensor(sensor::Sensor *max_sensor) { this->max_sensor_ = max_sensor; }
+  void set_mean_sensor(sensor::Sensor *mean_sensor) { this->mean_sensor_ = mean_sensor; }
+  void set_last_sensor(sensor::Sensor *last_sensor) { this->last_sensor_ = last_sensor; }
+
+  void add(float value);
+  // Publish and restart once the window has elapsed.
+  void loop(uint32_t now);
+
+ protected:
+  uint32_t window_;
+  uint32_t start_{0};
+  uint32_t count_{0};
+  float min_{0};
+  float max_{0};
+  float sum_{0};
+  float last_{0};
+
+  sensor::Sensor *min_sensor_{nullptr};
+  sensor::Sensor *max_sensor_{nullptr};
+  sensor::Sensor *mean_sensor_{nullptr};
+  sensor::Sensor *last_sensor_{nullptr};
+};
+
+}  // namespace opentherm
+}  // namespace esphome
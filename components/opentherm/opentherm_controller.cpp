@@ -0,0 +1,35 @@
+#include "opentherm_controller.h"
+
+namespace esphome {
+namespace opentherm {
+
+float OpenThermController::update(float room, float target, float outside, float dt)
+{
+  if (std::isnan(room) || std::isnan(target))
+    return this->output_;
+
+  float base = target + this->offset_;
+  if (!std::isnan(outside))
+    base += this->slope_ * (target - outside);
+
+  float error = target - room;
+  float integral = this->integral_ + this->ki_ * error * dt;
+  float output = base + this->kp_ * error + integral;
+  if (output > this->max_setpoint_) {
+    output = this->max_setpoint_;
+    if (error < 0)
+      this->integral_ = integral;
+  } else if (output < this->min_setpoint_) {
+    output = this->min_setpoint_;
+    if (error > 0)
+      this->integral_ = integral;
+  } else {
+    this->integral_ = integral;
+  }
+
+  this->output_ = output;
+  return output;
+}
+
+}  // namespace opentherm
+}  // namespace esphome
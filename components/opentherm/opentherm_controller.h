@@ -0,0 +1,57 @@
+#pragma once
+/*
+Room temperature controller computing the CH control setpoint (MSG_TSET).
+
+The setpoint is the sum of a heating curve and a PI correction on the room
+temperature error:
+
+  TSET = target + offset + slope * (target - outside) + kp * error + integral
+
+The heating curve term is left out while the outside temperature is unknown.
+The integral is only advanced while the output is not clamped in the direction
+of the error, so it does not wind up while the boiler is at its limits.
+*/
+
+#include <cmath>
+
+namespace esphome {
+namespace opentherm {
+
+class OpenThermController {
+ public:
+  void set_gains(float kp, float ki) {
+    this->kp_ = kp;
+    this->ki_ = ki;
+  }
+  void set_curve(float slope, float offset) {
+    this->slope_ = slope;
+    this->offset_ = offset;
+  }
+  void set_limits(float min_setpoint, float max_setpoint) {
+    this->min_setpoint_ = min_setpoint;
+    this->max_setpoint_ = max_setpoint;
+  }
+
+  // Advance the controller by dt seconds and return the new setpoint, or NAN
+  // while the room temperature or target is unknown.
+  float update(float room, float target, float outside, float dt);
+  void reset() {
+    this->integral_ = 0;
+    this->output_ = NAN;
+  }
+  float output() const { return this->output_; }
+
+ protected:
+  float kp_{5};
+  float ki_{0.002};
+  float slope_{1.5};
+  float offset_{0};
+  float min_setpoint_{20};
+  float max_setpoint_{70};
+
+  float integral_{0};
+  float output_{NAN};
+};
+
+}  // namespace opentherm
+}  // namespace esphome
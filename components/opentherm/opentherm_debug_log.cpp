@@ -0,0 +1,45 @@
+#include "opentherm_debug_log.h"
+#include <cinttypes>
+#include "opentherm.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace opentherm {
+
+static const char *TAG = "opentherm.frames";
+
+void OpenThermDebugLog::push(bool boiler, uint32_t frame, uint32_t timestamp)
+{
+  if (this->count_ == CAPACITY) {
+    this->head_ = (this->head_ + 1) % CAPACITY;
+    this->count_--;
+    this->overwritten_++;
+  }
+  this->records_[(this->head_ + this->count_) % CAPACITY] = Record{timestamp, frame, boiler};
+  this->count_++;
+}
+
+void OpenThermDebugLog::drain(uint8_t max)
+{
+  if (this->count_ > 0 && this->overwritten_ > 0) {
+    ESP_LOGW(TAG, "%" PRIu32 " frames not logged, log output is falling behind", this->overwritten_);
+    this->overwritten_ = 0;
+  }
+  for (; max > 0 && this->count_ > 0; max--) {
+    const Record &record = this->records_[this->head_];
+    const OpenThermMessageInfo *info = getMessageInfo(getDataID(record.frame));
+    char value[128];
+    describeValue(value, sizeof(value), record.frame);
+    if (info != nullptr)
+      ESP_LOGD(TAG, "%10" PRIu32 " %c %-15s %s: %s", record.timestamp, record.boiler ? 'B' : 'T',
+               messageTypeToString(getMessageType(record.frame)), info->name, value);
+    else
+      ESP_LOGD(TAG, "%10" PRIu32 " %c %-15s %u: %s", record.timestamp, record.boiler ? 'B' : 'T',
+               messageTypeToString(getMessageType(record.frame)), getDataID(record.frame), value);
+    this->head_ = (this->head_ + 1) % CAPACITY;
+    this->count_--;
+  }
+}
+
+}  // namespace opentherm
+}  // namespace esphome
@@ -0,0 +1,38 @@
+#pragma once
+/*
+Deferred protocol log.
+
+Decoded frames are pushed as small binary records; formatting and log output
+happen later, a few records per main loop iteration. When the ring is full the
+oldest records are overwritten, and the number lost is reported with the next
+record written out.
+*/
+
+#include <cstdint>
+
+namespace esphome {
+namespace opentherm {
+
+class OpenThermDebugLog {
+ public:
+  static const uint8_t CAPACITY = 64;
+
+  void push(bool boiler, uint32_t frame, uint32_t timestamp);
+  // Format and log at most max records.
+  void drain(uint8_t max);
+
+ protected:
+  struct Record {
+    uint32_t timestamp;
+    uint32_t frame;
+    bool boiler;
+  };
+
+  Record records_[CAPACITY];
+  uint8_t head_{0};  // oldest record
+  uint8_t count_{0};
+  uint32_t overwritten_{0};
+};
+
+}  // namespace opentherm
+}  // namespace esphome
@@ -0,0 +1,55 @@
+#include "opentherm_energy.h"
+
+namespace esphome {
+namespace opentherm {
+
+void OpenThermEnergy::advance(uint32_t now)
+{
+  uint32_t elapsed = now - this->last_;
+  this->last_ = now;
+  if (!this->started_) {
+    this->started_ = true;
+    return;
+  }
+  if (elapsed > MAX_GAP_MS)
+    return;
+
+  this->window_ms_ += elapsed;
+  if (this->flame_) {
+    this->flame_ms_ += elapsed;
+    this->window_flame_ms_ += elapsed;
+    this->modulation_ms_ += (uint64_t) this->modulation_ * elapsed;
+  }
+  if (this->ch_)
+    this->ch_ms_ += elapsed;
+  if (this->dhw_)
+    this->dhw_ms_ += elapsed;
+}
+
+void OpenThermEnergy::update_status(uint32_t now, bool flame, bool ch, bool dhw)
+{
+  this->advance(now);
+  this->flame_ = flame;
+  this->ch_ = ch;
+  this->dhw_ = dhw;
+}
+
+void OpenThermEnergy::update_modulation(uint32_t now, uint16_t modulation)
+{
+  this->advance(now);
+  // Clamp out of spec values; f8.8 is signed.
+  if (modulation & 0x8000)
+    modulation = 0;
+  this->modulation_ = modulation > (100 << 8) ? (100 << 8) : modulation;
+}
+
+float OpenThermEnergy::take_duty_cycle()
+{
+  float duty_cycle = this->window_ms_ > 0 ? 100.0f * this->window_flame_ms_ / this->window_ms_ : 0.0f;
+  this->window_flame_ms_ = 0;
+  this->window_ms_ = 0;
+  return duty_cycle;
+}
+
+}  // namespace opentherm
+}  // namespace esphome
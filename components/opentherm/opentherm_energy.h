@@ -0,0 +1,54 @@
+#pragma once
+/*
+Time-weighted accumulators for burner, CH and DHW activity.
+
+Every status or modulation response closes the interval since the previous
+one, integrating the state that was valid during it. Counters are kept in
+integer milliseconds, and modulation in f8.8 percent times milliseconds, so
+updates are a handful of integer operations and never lose precision. Gaps
+longer than MAX_GAP_MS, e.g. while the bus was down, are not counted.
+*/
+
+#include <cstdint>
+
+namespace esphome {
+namespace opentherm {
+
+class OpenThermEnergy {
+ public:
+  static const uint32_t MAX_GAP_MS = 60000;
+
+  void update_status(uint32_t now, bool flame, bool ch, bool dhw);
+  // Relative modulation level as the raw f8.8 value of MSG_REL_MOD_LEVEL.
+  void update_modulation(uint32_t now, uint16_t modulation);
+
+  float flame_hours() const { return this->flame_ms_ / 3600000.0f; }
+  float ch_hours() const { return this->ch_ms_ / 3600000.0f; }
+  float dhw_hours() const { return this->dhw_ms_ / 3600000.0f; }
+  // Burner hours at 100% modulation giving the same heat output.
+  float full_load_hours() const { return this->modulation_ms_ / (256.0f * 100.0f * 3600000.0f); }
+
+  // Percentage of time the flame was on since the previous call.
+  float take_duty_cycle();
+
+ protected:
+  void advance(uint32_t now);
+
+  bool started_{false};
+  uint32_t last_{0};
+  bool flame_{false};
+  bool ch_{false};
+  bool dhw_{false};
+  uint16_t modulation_{0};
+
+  uint64_t flame_ms_{0};
+  uint64_t ch_ms_{0};
+  uint64_t dhw_ms_{0};
+  uint64_t modulation_ms_{0};
+
+  uint64_t window_flame_ms_{0};
+  uint64_t window_ms_{0};
+};
+
+}  // namespace opentherm
+}  // namespace esphome
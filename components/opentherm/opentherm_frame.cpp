@@ -0,0 +1,177 @@
+#include "opentherm_frame.h"
+#include <cstdio>
+
+namespace esphome {
+namespace opentherm {
+
+const char *messageTypeToString(OpenThermMessageType message_type)
+{
+  switch (message_type) {
+    case READ_DATA:    return "READ_DATA";
+    case WRITE_DATA:    return "WRITE_DATA";
+    case INVALID_DATA:  return "INVALID_DATA";
+    case RESERVED:    return "RESERVED";
+    case READ_ACK:    return "READ_ACK";
+    case WRITE_ACK:    return "WRITE_ACK";
+    case DATA_INVALID:  return "DATA_INVALID";
+    case UNKNOWN_DATA_ID: return "UNKNOWN_DATA_ID";
+    default:        return "UNKNOWN";
+  }
+}
+
+// Sorted by data-ID.
+static const OpenThermMessageInfo MESSAGE_INFO[] = {
+  {MSG_STATUS, "STATUS", FLAG8_FLAG8},
+  {MSG_TSET, "TSET", F88},
+  {MSG_M_CONFIG_M_MEMBERIDCODE, "M_CONFIG_M_MEMBERIDCODE", FLAG8_U8},
+  {MSG_S_CONFIG_S_MEMBERIDCODE, "S_CONFIG_S_MEMBERIDCODE", FLAG8_U8},
+  {MSG_COMMAND, "COMMAND", U8_U8},
+  {MSG_ASF_FLAGS_OEM_FAULT_CODE, "ASF_FLAGS_OEM_FAULT_CODE", FLAG8_U8},
+  {MSG_RBP_FLAGS, "RBP_FLAGS", FLAG8_FLAG8},
+  {MSG_COOLING_CONTROL, "COOLING_CONTROL", F88},
+  {MSG_TSETCH2, "TSETCH2", F88},
+  {MSG_TROVERRIDE, "TROVERRIDE", F88},
+  {MSG_TSP, "TSP", U8_U8},
+  {MSG_TSP_INDEX_TSP_VALUE, "TSP_INDEX_TSP_VALUE", U8_U8},
+  {MSG_FHB_SIZE, "FHB_SIZE", U8_U8},
+  {MSG_FHB_INDEX_FHB_VALUE, "FHB_INDEX_FHB_VALUE", U8_U8},
+  {MSG_MAX_REL_MOD_LEVEL_SETTING, "MAX_REL_MOD_LEVEL_SETTING", F88},
+  {MSG_MAX_CAPACITY_MIN_MOD_LEVEL, "MAX_CAPACITY_MIN_MOD_LEVEL", U8_U8},
+  {MSG_TRSET, "TRSET", F88},
+  {MSG_REL_MOD_LEVEL, "REL_MOD_LEVEL", F88},
+  {MSG_CH_PRESSURE, "CH_PRESSURE", F88},
+  {MSG_DHW_FLOW_RATE, "DHW_FLOW_RATE", F88},
+  {MSG_DAY_TIME, "DAY_TIME", U8_U8},
+  {MSG_DATE, "DATE", U8_U8},
+  {MSG_YEAR, "YEAR", U16},
+  {MSG_TRSETCH2, "TRSETCH2", F88},
+  {MSG_TR, "TR", F88},
+  {MSG_TBOILER, "TBOILER", F88},
+  {MSG_TDHW, "TDHW", F88},
+  {MSG_TOUTSIDE, "TOUTSIDE", F88},
+  {MSG_TRET, "TRET", F88},
+  {MSG_TSTORAGE, "TSTORAGE", F88},
+  {MSG_TCOLLECTOR, "TCOLLECTOR", F88},
+  {MSG_TFLOWCH2, "TFLOWCH2", F88},
+  {MSG_TDHW2, "TDHW2", F88},
+  {MSG_TEXHAUST, "TEXHAUST", S16},
+  {MSG_TDHWSET_UB_LB, "TDHWSET_UB_LB", S8_S8},
+  {MSG_MAXTSET_UB_LB, "MAXTSET_UB_LB", S8_S8},
+  {MSG_HCRATIO_UB_LB, "HCRATIO_UB_LB", S8_S8},
+  {MSG_TDHWSET, "TDHWSET", F88},
+  {MSG_MAXTSET, "MAXTSET", F88},
+  {MSG_HCRATIO, "HCRATIO", F88},
+  {MSG_REMOTE_OVERRIDE_FUNCTION, "REMOTE_OVERRIDE_FUNCTION", FLAG8_FLAG8},
+  {MSG_OEM_DIAGNOSTIC_CODE, "OEM_DIAGNOSTIC_CODE", U16},
+  {MSG_BURNER_STARTS, "BURNER_STARTS", U16},
+  {MSG_CH_PUMP_STARTS, "CH_PUMP_STARTS", U16},
+  {MSG_DHW_PUMP_VALVE_STARTS, "DHW_PUMP_VALVE_STARTS", U16},
+  {MSG_DHW_BURNER_STARTS, "DHW_BURNER_STARTS", U16},
+  {MSG_BURNER_OPERATION_HOURS, "BURNER_OPERATION_HOURS", U16},
+  {MSG_CH_PUMP_OPERATION_HOURS, "CH_PUMP_OPERATION_HOURS", U16},
+  {MSG_DHW_PUMP_VALVE_OPERATION_HOURS, "DHW_PUMP_VALVE_OPERATION_HOURS", U16},
+  {MSG_DHW_BURNER_OPERATION_HOURS, "DHW_BURNER_OPERATION_HOURS", U16},
+  {MSG_OPENTHERM_VERSION_MASTER, "OPENTHERM_VERSION_MASTER", F88},
+  {MSG_OPENTHERM_VERSION_SLAVE, "OPENTHERM_VERSION_SLAVE", F88},
+  {MSG_MASTER_VERSION, "MASTER_VERSION", U8_U8},
+  {MSG_SLAVE_VERSION, "SLAVE_VERSION", U8_U8},
+};
+
+const OpenThermMessageInfo *getMessageInfo(uint8_t id)
+{
+  size_t low = 0, high = sizeof(MESSAGE_INFO) / sizeof(MESSAGE_INFO[0]);
+  while (low < high) {
+    size_t mid = (low + high) / 2;
+    if (MESSAGE_INFO[mid].id < id)
+      low = mid + 1;
+    else
+      high = mid;
+  }
+  if (low < sizeof(MESSAGE_INFO) / sizeof(MESSAGE_INFO[0]) && MESSAGE_INFO[low].id == id)
+    return &MESSAGE_INFO[low];
+  return nullptr;
+}
+
+int formatValue(char *buffer, size_t size, uint32_t frame)
+{
+  const OpenThermMessageInfo *info = getMessageInfo(getDataID(frame));
+  switch (info != nullptr ? info->type : U16) {
+    case F88:
+      return snprintf(buffer, size, "%.2f", getFloat(frame));
+    case S16:
+      return snprintf(buffer, size, "%d", getInt16(frame));
+    case FLAG8_FLAG8:
+      return snprintf(buffer, size, "0x%02X/0x%02X", getUBUInt8(frame), getLBUInt8(frame));
+    case FLAG8_U8:
+      return snprintf(buffer, size, "0x%02X/%u", getUBUInt8(frame), getLBUInt8(frame));
+    case U8_U8:
+      return snprintf(buffer, size, "%u/%u", getUBUInt8(frame), getLBUInt8(frame));
+    case S8_S8:
+      return snprintf(buffer, size, "%d/%d", getUBInt8(frame), getLBInt8(frame));
+    case U16:
+    default:
+      return snprintf(buffer, size, "%u", getUInt16(frame));
+  }
+}
+
+// Set bits of the flag bytes describeValue() spells out, bit 0 first.
+static const char *const FAULT_FLAGS[] = {
+  "service required",        // 0: service not required
+  "remote reset enabled",    // 1: remote reset disabled
+  "low water pressure",      // 2: no water pressure fault
+  "gas/flame fault",         // 3: no gas/flame fault
+  "air pressure fault",      // 4: no air pressure fault
+  "water over-temperature",  // 5: no over-temperature fault
+};
+static const char *const SLAVE_CONFIG_FLAGS[] = {
+  "DHW present",              // 0: no DHW
+  "on/off control",           // 1: modulating
+  "cooling supported",        // 2: no cooling
+  "DHW storage tank",         // 3: instantaneous or not specified
+  "no low-off pump control",  // 4: low-off and pump control allowed
+  "CH2 present",              // 5: no second CH circuit
+};
+// Day of week 0 means the master does not know it.
+static const char *const DAYS[] = {"", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat", "Sun"};
+
+static int appendFlags(char *buffer, size_t size, int len, uint8_t flags, const char *const *names, size_t count)
+{
+  const char *separator = " (";
+  for (size_t bit = 0; bit < count && len >= 0 && (size_t) len < size; bit++) {
+    if (!(flags & (1 << bit)))
+      continue;
+    len += snprintf(buffer + len, size - len, "%s%s", separator, names[bit]);
+    separator = ", ";
+  }
+  if (separator[0] == ',' && len >= 0 && (size_t) len < size)
+    len += snprintf(buffer + len, size - len, ")");
+  return len;
+}
+
+int describeValue(char *buffer, size_t size, uint32_t frame)
+{
+  int len = formatValue(buffer, size, frame);
+  if (len < 0 || (size_t) len >= size)
+    return len;
+  uint8_t hb = getUBUInt8(frame);
+  uint8_t lb = getLBUInt8(frame);
+  switch (getDataID(frame)) {
+    case MSG_ASF_FLAGS_OEM_FAULT_CODE:
+      return appendFlags(buffer, size, len, hb, FAULT_FLAGS, sizeof(FAULT_FLAGS) / sizeof(FAULT_FLAGS[0]));
+    case MSG_S_CONFIG_S_MEMBERIDCODE:
+      return appendFlags(buffer, size, len, hb, SLAVE_CONFIG_FLAGS,
+                         sizeof(SLAVE_CONFIG_FLAGS) / sizeof(SLAVE_CONFIG_FLAGS[0]));
+    case MSG_DAY_TIME:
+      // Day of week in bits 7-5 of the high byte, hours in bits 4-0, minutes in the low byte.
+      return len + snprintf(buffer + len, size - len, " (%s%s%02u:%02u)", DAYS[hb >> 5], hb >> 5 ? " " : "",
+                            hb & 0x1F, lb);
+    case MSG_DATE:
+      // Month in the high byte, day of month in the low byte.
+      return len + snprintf(buffer + len, size - len, " (day %u of month %u)", lb, hb);
+    default:
+      return len;
+  }
+}
+
+}  // namespace opentherm
+}  // namespace esphome
@@ -0,0 +1,267 @@
+#pragma once
+/*
+OpenTherm frame codec.
+
+OpenThermFrame wraps a raw 32-bit frame with constexpr accessors, so fixed
+frames can be built and checked at compile time and decoding inlines to a few
+instructions. The free functions on raw frames are kept as thin wrappers.
+
+This header has no dependencies outside the standard library and can be used
+by host tools.
+*/
+
+#include <cstddef>
+#include <cstdint>
+
+namespace esphome {
+namespace opentherm {
+
+enum OpenThermMessageType {
+/*  Master to Slave */
+READ_DATA       = 0,
+READ            = READ_DATA, // for backwared compatibility
+WRITE_DATA      = 1,
+WRITE           = WRITE_DATA, // for backwared compatibility
+INVALID_DATA    = 2,
+RESERVED        = 3,
+/* Slave to Master */
+READ_ACK        = 4,
+WRITE_ACK       = 5,
+DATA_INVALID    = 6,
+UNKNOWN_DATA_ID = 7
+};
+
+typedef OpenThermMessageType OpenThermRequestType; // for backwared compatibility
+
+enum OpenThermMessageID {
+// Master and Slave Status flags.
+MSG_STATUS = 0,
+// Control setpoint ie CH water temperature setpoint (°C)
+MSG_TSET = 1,
+// Master Configuration Flags / Master MemberID Code
+MSG_M_CONFIG_M_MEMBERIDCODE = 2,
+// Slave Configuration Flags / Slave MemberID Code
+MSG_S_CONFIG_S_MEMBERIDCODE = 3,
+// Remote Command
+MSG_COMMAND = 4,
+// Application-specific fault flags and OEM fault code
+MSG_ASF_FLAGS_OEM_FAULT_CODE = 5,
+// Remote boiler parameter transfer-enable & read/write flags
+MSG_RBP_FLAGS = 6,
+// Cooling control signal (%)
+MSG_COOLING_CONTROL = 7,
+// Control setpoint for 2nd CH circuit (°C)
+MSG_TSETCH2 = 8,
+// Remote override room setpoint
+MSG_TROVERRIDE = 9,
+// Number of Transparent-Slave-Parameters supported by slave
+MSG_TSP = 10,
+// Index number / Value of referred-to transparent slave parameter.
+MSG_TSP_INDEX_TSP_VALUE = 11,
+// Size of Fault-History-Buffer supported by slave
+MSG_FHB_SIZE = 12,
+// Index number / Value of referred-to fault-history buffer entry.
+MSG_FHB_INDEX_FHB_VALUE = 13,
+// Maximum relative modulation level setting (%)
+MSG_MAX_REL_MOD_LEVEL_SETTING = 14,
+// Maximum boiler capacity (kW) / Minimum boiler modulation level(%)
+MSG_MAX_CAPACITY_MIN_MOD_LEVEL = 15,
+// Room Setpoint (°C)
+MSG_TRSET = 16,
+// Relative Modulation Level (%)
+MSG_REL_MOD_LEVEL = 17,
+// Water pressure in CH circuit (bar)
+MSG_CH_PRESSURE = 18,
+// Water flow rate in DHW circuit. (litres/minute)
+MSG_DHW_FLOW_RATE = 19,
+// Day of Week and Time of Day
+MSG_DAY_TIME = 20,
+// Calendar date
+MSG_DATE = 21,
+// Calendar year
+MSG_YEAR = 22,
+// Room Setpoint for 2nd CH circuit (°C)
+MSG_TRSETCH2 = 23,
+// Room temperature (°C)
+MSG_TR = 24,
+// Boiler flow water temperature (°C)
+MSG_TBOILER = 25,
+// DHW temperature (°C)
+MSG_TDHW = 26,
+// Outside temperature (°C)
+MSG_TOUTSIDE = 27,
+// Return water temperature (°C)
+MSG_TRET = 28,
+// Solar storage temperature (°C)
+MSG_TSTORAGE = 29,
+// Solar collector temperature (°C)
+MSG_TCOLLECTOR = 30,
+// Flow water temperature CH2 circuit (°C)
+MSG_TFLOWCH2 = 31,
+// Domestic hot water temperature 2 (°C)
+MSG_TDHW2 = 32,
+// Boiler exhaust temperature (°C)
+MSG_TEXHAUST = 33,
+// DHW setpoint upper & lower bounds for adjustment (°C)
+MSG_TDHWSET_UB_LB = 48,
+// Max CH water setpoint upper & lower bounds for adjustment (°C)
+MSG_MAXTSET_UB_LB = 49,
+// OTC heat curve ratio upper & lower bounds for adjustment
+MSG_HCRATIO_UB_LB = 50,
+// DHW setpoint (°C) (Remote parameter 1)
+MSG_TDHWSET = 56,
+// Max CH water setpoint (°C) (Remote parameters 2)
+MSG_MAXTSET = 57,
+// OTC heat curve ratio (°C) (Remote parameter 3)
+MSG_HCRATIO = 58,
+// Function of manual and program changes in master and remote room setpoint.
+MSG_REMOTE_OVERRIDE_FUNCTION = 100,
+// OEM-specific diagnostic/service code
+MSG_OEM_DIAGNOSTIC_CODE = 115,
+// Number of starts burner
+MSG_BURNER_STARTS = 116,
+// Number of starts CH pump
+MSG_CH_PUMP_STARTS = 117,
+// Number of starts DHW pump/valve
+MSG_DHW_PUMP_VALVE_STARTS = 118,
+// Number of starts burner during DHW mode
+MSG_DHW_BURNER_STARTS = 119,
+// Number of hours that burner is in operation (i.e. flame on)
+MSG_BURNER_OPERATION_HOURS = 120,
+// Number of hours that CH pump has been running
+MSG_CH_PUMP_OPERATION_HOURS = 121,
+// Number of hours that DHW pump has been running or DHW valve has been opened
+MSG_DHW_PUMP_VALVE_OPERATION_HOURS = 122,
+// Number of hours that burner is in operation during DHW mode
+MSG_DHW_BURNER_OPERATION_HOURS = 123,
+// The implemented version of the OpenTherm Protocol Specification in the master.
+MSG_OPENTHERM_VERSION_MASTER = 124,
+// The implemented version of the OpenTherm Protocol Specification in the slave.
+MSG_OPENTHERM_VERSION_SLAVE = 125,
+// Master product version number and type
+MSG_MASTER_VERSION = 126,
+// Slave product version number and type
+MSG_SLAVE_VERSION = 127
+};
+
+// Layout of the 16-bit value of a data-ID.
+enum OpenThermValueType {
+F88,
+U16,
+S16,
+FLAG8_FLAG8,
+FLAG8_U8,
+U8_U8,
+S8_S8
+};
+
+struct OpenThermMessageInfo {
+  uint8_t id;
+  const char *name;
+  OpenThermValueType type;
+};
+
+// True when the frame has an odd number of set bits.
+constexpr bool parity(uint32_t frame) { return __builtin_parity((unsigned int) frame); }
+
+class OpenThermFrame {
+ public:
+  constexpr OpenThermFrame() : raw_(0) {}
+  constexpr explicit OpenThermFrame(uint32_t raw) : raw_(raw) {}
+
+  // Build a frame with the parity bit set so the total number of set bits is even.
+  static constexpr OpenThermFrame build(OpenThermMessageType type, OpenThermMessageID id, uint16_t data) {
+    return OpenThermFrame(with_parity(((uint32_t)(type & 7) << 28) | ((uint32_t) id << 16) | data));
+  }
+  // Requests only distinguish reads and writes.
+  static constexpr OpenThermFrame request(OpenThermMessageType type, OpenThermMessageID id, uint16_t data) {
+    return build(type == WRITE_DATA ? WRITE_DATA : READ_DATA, id, data);
+  }
+  static constexpr OpenThermFrame response(OpenThermMessageType type, OpenThermMessageID id, uint16_t data) {
+    return build(type, id, data);
+  }
+
+  constexpr uint32_t raw() const { return this->raw_; }
+  constexpr OpenThermMessageType type() const { return (OpenThermMessageType)((this->raw_ >> 28) & 7); }
+  constexpr OpenThermMessageID id() const { return (OpenThermMessageID)((this->raw_ >> 16) & 0xFF); }
+  constexpr bool parity_ok() const { return !parity(this->raw_); }
+  constexpr bool is_request() const { return this->type() <= INVALID_DATA; }
+  constexpr bool is_response() const { return this->type() >= READ_ACK; }
+
+  constexpr uint16_t value() const { return this->raw_ & 0xFFFF; }
+  constexpr int16_t s16() const { return (int16_t) this->value(); }
+  constexpr uint8_t hb() const { return (this->raw_ >> 8) & 0xFF; }
+  constexpr uint8_t lb() const { return this->raw_ & 0xFF; }
+  constexpr int8_t hb_s8() const { return (int8_t) this->hb(); }
+  constexpr int8_t lb_s8() const { return (int8_t) this->lb(); }
+  constexpr float f88() const { return this->s16() / 256.0f; }
+
+  // Same frame with another value, parity recomputed.
+  constexpr OpenThermFrame with_value(uint16_t data) const {
+    return OpenThermFrame(with_parity((this->raw_ & 0x7FFF0000) | data));
+  }
+
+  constexpr bool operator==(const OpenThermFrame &other) const { return this->raw_ == other.raw_; }
+  constexpr bool operator!=(const OpenThermFrame &other) const { return this->raw_ != other.raw_; }
+
+ protected:
+  static constexpr uint32_t with_parity(uint32_t frame) {
+    return (frame & 0x7FFFFFFF) | (parity(frame & 0x7FFFFFFF) ? 1ul << 31 : 0);
+  }
+
+  uint32_t raw_;
+};
+
+// f8.8 encoding of a temperature, clamped to 0..100 °C.
+constexpr uint16_t temperatureToData(float temperature) {
+  return (uint16_t)((temperature < 0 ? 0 : temperature > 100 ? 100 : temperature) * 256);
+}
+
+// Fixed frames the gateway sends, verified at compile time.
+namespace frames {
+constexpr OpenThermFrame READ_STATUS = OpenThermFrame::request(READ_DATA, MSG_STATUS, 0x0000);
+constexpr OpenThermFrame READ_TSP = OpenThermFrame::request(READ_DATA, MSG_TSP, 0);
+constexpr OpenThermFrame READ_FHB_SIZE = OpenThermFrame::request(READ_DATA, MSG_FHB_SIZE, 0);
+
+static_assert(READ_STATUS.raw() == 0x00000000, "status read");
+static_assert(READ_STATUS.with_value(0x0300).raw() == 0x00000300, "status read with CH and DHW enabled");
+static_assert(READ_STATUS.with_value(0x0200).raw() == 0x80000200, "parity bit");
+static_assert(READ_TSP.raw() == 0x000A0000, "TSP count read");
+static_assert(READ_FHB_SIZE.raw() == 0x000C0000, "FHB size read");
+static_assert(OpenThermFrame::request(READ_DATA, MSG_SLAVE_VERSION, 0).raw() == 0x807F0000, "slave product version read");
+static_assert(OpenThermFrame::request(WRITE_DATA, MSG_TSET, temperatureToData(45)).raw() == 0x10012D00, "TSET write");
+static_assert(OpenThermFrame(0x40012D00).type() == READ_ACK && OpenThermFrame(0x40012D00).f88() == 45.0f, "decode");
+static_assert(OpenThermFrame(0x80000200).parity_ok() && !OpenThermFrame(0x00000200).parity_ok(), "parity check");
+}  // namespace frames
+
+inline uint32_t buildRequest(OpenThermMessageType type, OpenThermMessageID id, uint16_t data) {
+  return OpenThermFrame::request(type, id, data).raw();
+}
+inline uint32_t buildResponse(OpenThermMessageType type, OpenThermMessageID id, uint16_t data) {
+  return OpenThermFrame::response(type, id, data).raw();
+}
+inline OpenThermMessageType getMessageType(uint32_t message) { return OpenThermFrame(message).type(); }
+inline OpenThermMessageID getDataID(uint32_t frame) { return OpenThermFrame(frame).id(); }
+inline bool isValidRequest(uint32_t request) {
+  return OpenThermFrame(request).type() <= INVALID_DATA;
+}
+inline bool isValidResponse(uint32_t response) { return OpenThermFrame(response).is_response(); }
+inline uint32_t modifyMsgData(uint32_t msg, uint16_t data) { return OpenThermFrame(msg).with_value(data).raw(); }
+inline uint8_t getUBUInt8(const uint32_t response) { return OpenThermFrame(response).hb(); }
+inline uint8_t getLBUInt8(const uint32_t response) { return OpenThermFrame(response).lb(); }
+inline int8_t getUBInt8(const uint32_t response) { return OpenThermFrame(response).hb_s8(); }
+inline int8_t getLBInt8(const uint32_t response) { return OpenThermFrame(response).lb_s8(); }
+inline uint16_t getUInt16(const uint32_t response) { return OpenThermFrame(response).value(); }
+inline int16_t getInt16(const uint32_t response) { return OpenThermFrame(response).s16(); }
+inline float getFloat(const uint32_t response) { return OpenThermFrame(response).f88(); }
+
+const char *messageTypeToString(OpenThermMessageType message_type);
+// Name and value layout of a data-ID, nullptr for unknown IDs.
+const OpenThermMessageInfo *getMessageInfo(uint8_t id);
+// Format the value of a frame according to its layout, returns the length written.
+int formatValue(char *buffer, size_t size, uint32_t frame);
+// formatValue() followed by the meaning of flag bits and date/time fields, for logs.
+int describeValue(char *buffer, size_t size, uint32_t frame);
+
+}  // namespace opentherm
+}  // namespace esphome
@@ -0,0 +1,315 @@
+#include "opentherm_frame_log.h"
+#include "opentherm.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+#include <cinttypes>
+#include <cstring>
+#include <memory>
+
+namespace esphome {
+namespace opentherm {
+
+static const char *TAG = "opentherm.frame_log";
+
+static const uint32_t SECTOR_MAGIC = 0x4F544C47;  // "OTLG"
+static const uint8_t UNKNOWN_TYPE = 0xFF;
+static const uint8_t RECORD_BOILER = 1 << 4;
+static const uint8_t RECORD_VALUE = 1 << 3;
+static const size_t MAX_RECORD_SIZE = 1 + 5 + 1 + 3;
+// Records logged per loop() while dumping.
+static const uint8_t DUMP_RECORDS_PER_LOOP = 8;
+
+static size_t put_varint(uint8_t *out, uint32_t value)
+{
+  size_t len = 0;
+  while (value >= 0x80) {
+    out[len++] = (value & 0x7F) | 0x80;
+    value >>= 7;
+  }
+  out[len++] = value;
+  return len;
+}
+
+static bool get_varint(const uint8_t *data, size_t len, size_t &pos, uint32_t &value)
+{
+  value = 0;
+  for (uint8_t shift = 0; pos < len && shift < 35; shift += 7) {
+    uint8_t b = data[pos++];
+    value |= (uint32_t)(b & 0x7F) << shift;
+    if ((b & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+bool OpenThermRamLogStorage::begin()
+{
+  RAMAllocator<uint8_t> allocator;
+  this->data_ = allocator.allocate(this->size_);
+  if (this->data_ == nullptr)
+    return false;
+  memset(this->data_, 0xFF, this->size_);
+  return true;
+}
+
+bool OpenThermRamLogStorage::erase(size_t offset, size_t len)
+{
+  memset(this->data_ + offset, 0xFF, len);
+  return true;
+}
+
+bool OpenThermRamLogStorage::write(size_t offset, const uint8_t *data, size_t len)
+{
+  memcpy(this->data_ + offset, data, len);
+  return true;
+}
+
+bool OpenThermRamLogStorage::read(size_t offset, uint8_t *data, size_t len)
+{
+  memcpy(data, this->data_ + offset, len);
+  return true;
+}
+
+#ifdef USE_ESP32
+bool OpenThermFlashLogStorage::begin()
+{
+  this->partition_ = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, this->label_);
+  if (this->partition_ == nullptr)
+    ESP_LOGE(TAG, "Partition '%s' not found", this->label_);
+  return this->partition_ != nullptr;
+}
+
+bool OpenThermFlashLogStorage::erase(size_t offset, size_t len)
+{
+  return esp_partition_erase_range(this->partition_, offset, len) == ESP_OK;
+}
+
+bool OpenThermFlashLogStorage::write(size_t offset, const uint8_t *data, size_t len)
+{
+  return esp_partition_write(this->partition_, offset, data, len) == ESP_OK;
+}
+
+bool OpenThermFlashLogStorage::read(size_t offset, uint8_t *data, size_t len)
+{
+  return esp_partition_read(this->partition_, offset, data, len) == ESP_OK;
+}
+#endif
+
+bool OpenThermFrameLog::begin()
+{
+  if (!this->storage_->begin() || this->sector_count() < 2) {
+    ESP_LOGE(TAG, "Frame log storage unavailable");
+    return false;
+  }
+
+  // Continue after the most recently written sector.
+  bool found = false;
+  size_t newest = 0;
+  uint32_t newest_sequence = 0;
+  SectorHeader header;
+  for (size_t i = 0; i < this->sector_count(); i++) {
+    if (this->read_header(i, header) && (!found || (int32_t)(header.sequence - newest_sequence) > 0)) {
+      found = true;
+      newest = i;
+      newest_sequence = header.sequence;
+    }
+  }
+
+  this->ready_ = true;
+  // Erased inline here only, setup() runs before any frame is relayed.
+  if (found)
+    this->start_sector((newest + 1) % this->sector_count(), newest_sequence + 1);
+  else
+    this->start_sector(0, 0);
+  return true;
+}
+
+bool OpenThermFrameLog::read_header(size_t index, SectorHeader &header)
+{
+  return this->storage_->read(index * SECTOR_SIZE, (uint8_t *) &header, sizeof(header)) &&
+         header.magic == SECTOR_MAGIC;
+}
+
+void OpenThermFrameLog::start_sector(size_t index, uint32_t sequence)
+{
+  this->sector_ = index;
+  this->sequence_ = sequence;
+  if (!this->next_erased_)
+    this->storage_->erase(index * SECTOR_SIZE, SECTOR_SIZE);
+  this->next_erased_ = false;
+
+  SectorHeader header{SECTOR_MAGIC, sequence, millis()};
+  this->storage_->write(index * SECTOR_SIZE, (const uint8_t *) &header, sizeof(header));
+  this->offset_ = index * SECTOR_SIZE + sizeof(header);
+  this->last_time_ = header.uptime_ms;
+
+  memset(this->last_value_, 0, sizeof(this->last_value_));
+  memset(this->last_type_, UNKNOWN_TYPE, sizeof(this->last_type_));
+}
+
+void OpenThermFrameLog::record(bool boiler, uint32_t frame)
+{
+  if (!this->ready_)
+    return;
+
+  uint8_t type = getMessageType(frame);
+  uint8_t id = getDataID(frame);
+  uint16_t value = getUInt16(frame);
+  uint8_t dir = boiler ? 1 : 0;
+  if (this->last_type_[dir][id] == type && this->last_value_[dir][id] == value) {
+    this->frames_skipped_++;
+    return;
+  }
+
+  size_t sector_end = (this->sector_ + 1) * SECTOR_SIZE;
+  if (this->offset_ + this->buffer_len_ + MAX_RECORD_SIZE > sector_end) {
+    if (!this->next_erased_) {
+      this->frames_dropped_++;
+      return;
+    }
+    this->flush();
+    this->start_sector((this->sector_ + 1) % this->sector_count(), this->sequence_ + 1);
+  }
+  if (this->buffer_len_ + MAX_RECORD_SIZE > sizeof(this->buffer_))
+    this->flush();
+
+  uint32_t now = millis();
+  uint8_t *out = this->buffer_ + this->buffer_len_;
+  size_t len = 0;
+  bool has_value = value != this->last_value_[dir][id];
+  out[len++] = type | (boiler ? RECORD_BOILER : 0) | (has_value ? RECORD_VALUE : 0);
+  len += put_varint(out + len, now - this->last_time_);
+  out[len++] = id;
+  if (has_value) {
+    int16_t change = (int16_t)(value - this->last_value_[dir][id]);
+    len += put_varint(out + len, (uint16_t)((change << 1) ^ (change >> 15)));
+  }
+  this->buffer_len_ += len;
+
+  this->last_time_ = now;
+  this->last_type_[dir][id] = type;
+  this->last_value_[dir][id] = value;
+  this->frames_recorded_++;
+}
+
+void OpenThermFrameLog::flush()
+{
+  if (this->buffer_len_ == 0)
+    return;
+  this->storage_->write(this->offset_, this->buffer_, this->buffer_len_);
+  this->offset_ += this->buffer_len_;
+  this->buffer_len_ = 0;
+}
+
+void OpenThermFrameLog::prepare()
+{
+  if (!this->ready_ || this->next_erased_)
+    return;
+  size_t next = (this->sector_ + 1) % this->sector_count();
+  this->next_erased_ = this->storage_->erase(next * SECTOR_SIZE, SECTOR_SIZE);
+}
+
+void OpenThermFrameLog::loop()
+{
+  if (this->dump_ == nullptr)
+    return;
+
+  OpenThermLogEntry entry;
+  for (uint8_t i = 0; i < DUMP_RECORDS_PER_LOOP; i++) {
+    if (!this->next_entry(*this->dump_, entry)) {
+      ESP_LOGI(TAG, "End of frame log");
+      this->dump_.reset();
+      return;
+    }
+    ESP_LOGI(TAG, "#%" PRIu32 " %10" PRIu32 " ms %c%08" PRIX32, entry.sector, entry.uptime_ms,
+             entry.boiler ? 'B' : 'T', entry.frame);
+  }
+}
+
+void OpenThermFrameLog::begin_replay(Cursor &cursor)
+{
+  this->flush();
+  cursor.n = 0;
+  cursor.pos = SECTOR_SIZE;
+  if (cursor.data == nullptr)
+    cursor.data.reset(new uint8_t[SECTOR_SIZE]);
+}
+
+// Sectors are copied out whole, so records written or sectors erased while a
+// replay is under way do not disturb it.
+bool OpenThermFrameLog::next_entry(Cursor &cursor, OpenThermLogEntry &entry)
+{
+  uint8_t *data = cursor.data.get();
+  size_t count = this->sector_count();
+  for (;;) {
+    if (cursor.pos >= SECTOR_SIZE || data[cursor.pos] == 0xFF) {
+      // The sector after the one being written is the oldest.
+      if (cursor.n == count)
+        return false;
+      cursor.n++;
+      size_t index = (this->sector_ + cursor.n) % count;
+      cursor.pos = SECTOR_SIZE;
+      if (!this->read_header(index, cursor.header) || !this->storage_->read(index * SECTOR_SIZE, data, SECTOR_SIZE))
+        continue;
+      memset(cursor.baseline, 0, sizeof(cursor.baseline));
+      cursor.entry.sector = cursor.header.sequence;
+      cursor.entry.uptime_ms = cursor.header.uptime_ms;
+      cursor.pos = sizeof(SectorHeader);
+      continue;
+    }
+
+    size_t pos = cursor.pos;
+    uint8_t flags = data[pos++];
+    uint32_t delta;
+    if (!get_varint(data, SECTOR_SIZE, pos, delta) || pos >= SECTOR_SIZE) {
+      cursor.pos = SECTOR_SIZE;
+      continue;
+    }
+    uint8_t id = data[pos++];
+    uint8_t dir = (flags & RECORD_BOILER) ? 1 : 0;
+    if (flags & RECORD_VALUE) {
+      uint32_t zigzag;
+      if (!get_varint(data, SECTOR_SIZE, pos, zigzag)) {
+        cursor.pos = SECTOR_SIZE;
+        continue;
+      }
+      cursor.baseline[dir][id] += (int16_t)((zigzag >> 1) ^ -(int32_t)(zigzag & 1));
+    }
+    cursor.pos = pos;
+
+    cursor.entry.uptime_ms += delta;
+    cursor.entry.boiler = dir == 1;
+    cursor.entry.frame = ((uint32_t)(flags & 7) << 28) | ((uint32_t) id << 16) | cursor.baseline[dir][id];
+    if (parity(cursor.entry.frame))
+      cursor.entry.frame |= 1ul << 31;
+    entry = cursor.entry;
+    return true;
+  }
+}
+
+void OpenThermFrameLog::replay(const std::function<void(const OpenThermLogEntry &)> &callback)
+{
+  if (!this->ready_)
+    return;
+  Cursor cursor;
+  this->begin_replay(cursor);
+  OpenThermLogEntry entry;
+  while (this->next_entry(cursor, entry))
+    callback(entry);
+}
+
+void OpenThermFrameLog::dump()
+{
+  ESP_LOGI(TAG, "Frame log: %" PRIu32 " frames recorded, %" PRIu32 " unchanged frames skipped, %" PRIu32 " dropped",
+           this->frames_recorded_, this->frames_skipped_, this->frames_dropped_);
+  if (!this->ready_)
+    return;
+  // A dump already under way starts over.
+  if (this->dump_ == nullptr)
+    this->dump_.reset(new Cursor());
+  this->begin_replay(*this->dump_);
+}
+
+}  // namespace opentherm
+}  // namespace esphome
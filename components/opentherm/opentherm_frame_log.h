@@ -0,0 +1,157 @@
+#pragma once
+/*
+Long-term OpenTherm frame log.
+
+Frames are only recorded when their message type or value differs from the last
+one logged for the same data-ID and direction. Each record is
+
+  header  : bit 7 = 0, bit 4 = boiler response, bit 3 = value follows, bits 0-2 = message type
+  delta   : varint, milliseconds since the previous record in this sector
+  data-ID : 1 byte
+  value   : zigzag varint of the change against the last logged value (if flagged)
+
+Storage is divided in 4 KiB sectors used as a ring. Every sector starts with a
+header and resets the per-ID baseline, so each sector decodes on its own and the
+oldest sector can be erased without losing the meaning of the others. Writing
+round-robin over all sectors levels the wear on flash.
+
+Erasing a flash sector takes tens of milliseconds, so the sector after the one
+being written is erased ahead of time by prepare(), never when a record is
+added. dump() only starts a dump; loop() logs a few records per call.
+*/
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include "esphome/core/defines.h"
+
+#ifdef USE_ESP32
+#include <esp_partition.h>
+#endif
+
+namespace esphome {
+namespace opentherm {
+
+class OpenThermLogStorage {
+ public:
+  virtual ~OpenThermLogStorage() = default;
+  virtual bool begin() = 0;
+  virtual size_t size() const = 0;
+  virtual bool erase(size_t offset, size_t len) = 0;
+  virtual bool write(size_t offset, const uint8_t *data, size_t len) = 0;
+  virtual bool read(size_t offset, uint8_t *data, size_t len) = 0;
+};
+
+// Volatile ring in RAM, allocated in PSRAM when the board has it.
+class OpenThermRamLogStorage : public OpenThermLogStorage {
+ public:
+  OpenThermRamLogStorage(size_t size) : size_(size) {}
+  bool begin() override;
+  size_t size() const override { return this->size_; }
+  bool erase(size_t offset, size_t len) override;
+  bool write(size_t offset, const uint8_t *data, size_t len) override;
+  bool read(size_t offset, uint8_t *data, size_t len) override;
+
+ protected:
+  size_t size_;
+  uint8_t *data_{nullptr};
+};
+
+#ifdef USE_ESP32
+// Persistent ring in a dedicated data partition.
+class OpenThermFlashLogStorage : public OpenThermLogStorage {
+ public:
+  OpenThermFlashLogStorage(const char *label) : label_(label) {}
+  bool begin() override;
+  size_t size() const override { return this->partition_ != nullptr ? this->partition_->size : 0; }
+  bool erase(size_t offset, size_t len) override;
+  bool write(size_t offset, const uint8_t *data, size_t len) override;
+  bool read(size_t offset, uint8_t *data, size_t len) override;
+
+ protected:
+  const char *label_;
+  const esp_partition_t *partition_{nullptr};
+};
+#endif
+
+struct OpenThermLogEntry {
+  uint32_t sector;     // sequence number of the sector holding the record
+  uint32_t uptime_ms;  // uptime of the recording boot
+  bool boiler;         // boiler response, otherwise thermostat request
+  uint32_t frame;
+};
+
+class OpenThermFrameLog {
+ public:
+  static const size_t SECTOR_SIZE = 4096;
+
+  OpenThermFrameLog(OpenThermLogStorage *storage) : storage_(storage) {}
+
+  bool begin();
+  // Erase the next sector ahead of time, if not done yet. Call when the bus
+  // can spare the time.
+  void prepare();
+  // Continue a dump.
+  void loop();
+  void record(bool boiler, uint32_t frame);
+  void flush();
+  // Decode all stored records, oldest first.
+  void replay(const std::function<void(const OpenThermLogEntry &)> &callback);
+  // Log all stored records, spread over the next loop() calls.
+  void dump();
+
+  size_t size() const { return this->storage_->size(); }
+  uint32_t frames_recorded() const { return this->frames_recorded_; }
+  uint32_t frames_skipped() const { return this->frames_skipped_; }
+  uint32_t frames_dropped() const { return this->frames_dropped_; }
+
+ protected:
+  struct SectorHeader {
+    uint32_t magic;
+    uint32_t sequence;
+    uint32_t uptime_ms;
+  };
+
+  // Position of a replay: sector n after the one being written, byte pos in it.
+  struct Cursor {
+    size_t n{0};
+    size_t pos{0};
+    SectorHeader header;
+    OpenThermLogEntry entry;
+    uint16_t baseline[2][256];
+    std::unique_ptr<uint8_t[]> data;
+  };
+
+  size_t sector_count() const { return this->storage_->size() / SECTOR_SIZE; }
+  void start_sector(size_t index, uint32_t sequence);
+  bool read_header(size_t index, SectorHeader &header);
+  void begin_replay(Cursor &cursor);
+  bool next_entry(Cursor &cursor, OpenThermLogEntry &entry);
+
+  OpenThermLogStorage *storage_;
+  bool ready_{false};
+  size_t sector_{0};
+  uint32_t sequence_{0};
+  size_t offset_{0};  // next free byte in storage
+  uint32_t last_time_{0};
+  // The sector after sector_ has been erased and can be started right away.
+  bool next_erased_{false};
+
+  std::unique_ptr<Cursor> dump_;
+
+  uint8_t buffer_[256];
+  size_t buffer_len_{0};
+
+  // Baseline per direction and data-ID, reset at the start of every sector.
+  uint16_t last_value_[2][256];
+  uint8_t last_type_[2][256];
+
+  uint32_t frames_recorded_{0};
+  uint32_t frames_skipped_{0};
+  // Records lost because the next sector was not erased in time.
+  uint32_t frames_dropped_{0};
+};
+
+}  // namespace opentherm
+}  // namespace esphome
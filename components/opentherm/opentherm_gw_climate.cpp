@@ -1,11 +1,35 @@
 #include "opentherm_gw_climate.h"
 #include "esphome/core/log.h"
+#include <algorithm>
+#include <cinttypes>
+
+#ifdef USE_OPENTHERM_LIGHT_SLEEP
+#include <esp_sleep.h>
+#endif
 
 namespace esphome {
 namespace opentherm {
 
 static const char *TAG = "opentherm_gw.climate";
 
+// How long after a relayed transaction the gateway may still use the boiler bus.
+static const uint32_t INJECTION_WINDOW_MS = 250;
+// How long a thermostat request may wait for the boiler bus to become free.
+// An injected exchange holds it for its 100 ms inter-frame delay at most.
+static const uint32_t RELAY_WAIT_MS = 150;
+// Longest a gateway exchange can hold the boiler bus: the channel gives up on a
+// response after 1 s and then keeps the 100 ms inter-frame delay.
+static const uint32_t WORST_CASE_EXCHANGE_MS = 1100;
+// Oldest boiler response a thermostat read may be answered with while the
+// gateway's own request takes its place.
+static const uint32_t SUBSTITUTE_MAX_AGE_MS = 30000;
+// Longer gaps mean the thermostat went quiet, not that it polls slowly.
+static const uint32_t MAX_THERMOSTAT_INTERVAL_MS = 10000;
+// Longest text sensor state Home Assistant accepts.
+static const size_t MAX_STATE_LENGTH = 255;
+// TSP and FHB entries per log line.
+static const uint8_t PARAMETERS_PER_LINE = 32;
+
 OpenThermGWClimate::OpenThermGWClimate()
      : mOT(),
       sOT(true)
@@ -13,28 +37,334 @@ OpenThermGWClimate::OpenThermGWClimate()
 }
 
 void OpenThermGWClimate::setup() {
-  // restore set points
+  // restore set points; the thermostat's setpoint stays in charge until the
+  // target is changed on this side.
   auto restore = this->restore_state_();
   if (restore.has_value()) {
-    restore->to_call(this).perform();
+    restore->apply(this);
   } else {
     this->mode = climate::CLIMATE_MODE_AUTO;
   }
 
-  mOT.setup(std::bind(&OpenThermGWClimate::processRequest, this, std::placeholders::_1, std::placeholders::_2));
-  sOT.setup(nullptr);
+  if (this->passive_) {
+    mOT.set_passive(true);
+    sOT.set_passive(true);
+    mOT.setup(std::bind(&OpenThermGWClimate::sniffRequest, this, std::placeholders::_1, std::placeholders::_2));
+    sOT.setup(std::bind(&OpenThermGWClimate::sniffResponse, this, std::placeholders::_1, std::placeholders::_2));
+  } else {
+    mOT.setup(std::bind(&OpenThermGWClimate::relay, this, std::placeholders::_1, std::placeholders::_2));
+    sOT.setup(nullptr);
+  }
+
+  if (this->frame_log_ != nullptr && this->frame_log_->begin()) {
+    // Bound what is lost on a power cut without writing a page per frame.
+    this->set_interval("frame_log", 60000, [this]() { this->frame_log_->flush(); });
+  }
+
+  if (this->snapshot_interval_ > 0) {
+    this->snapshot_.begin(fnv1_hash("opentherm_snapshot") ^ this->get_object_id_hash());
+    uint8_t restored = this->snapshot_.replay([this](bool boiler, uint32_t frame) {
+      if (boiler)
+        processResponse(frame);
+      else
+        processRequest(frame);
+    });
+    ESP_LOGD(TAG, "Restored %u values from the last snapshot", restored);
+    if (this->is_restored_stale != nullptr)
+      this->is_restored_stale->publish_state(restored > 0);
+    this->set_interval("snapshot", this->snapshot_interval_, [this]() { this->snapshot_.save(); });
+  }
+
+#ifdef USE_OPENTHERM_MQTT_BATCH
+  if (this->mqtt_batch_ != nullptr)
+    this->mqtt_batch_->begin();
+#endif
+
+#ifdef USE_OPENTHERM_METRICS
+  if (this->metrics_ != nullptr) {
+    this->metrics_->set_sources(&this->state_, &this->counters_);
+#ifdef USE_OPENTHERM_BUS_PROFILE
+    this->metrics_->set_bus_profiles(&mOT.getBusProfile(), &sOT.getBusProfile());
+#endif
+    if (!this->metrics_->begin())
+      this->metrics_ = nullptr;
+  }
+#endif
+
+  flushPublishes();
+
+  if (this->adaptive_polling_ && !this->passive_) {
+    this->poller_.add(MSG_DHW_FLOW_RATE, STATUS_DHW_ACTIVE);
+    this->poller_.add(MSG_TDHW, STATUS_DHW_ACTIVE);
+    this->poller_.add(MSG_REL_MOD_LEVEL, STATUS_FLAME_ON);
+    this->poller_.add(MSG_TBOILER, STATUS_CH_ACTIVE | STATUS_DHW_ACTIVE);
+    this->poller_.add(MSG_TRET, STATUS_CH_ACTIVE);
+    // The heating curve needs the outside temperature even if the thermostat never reads it.
+    if (this->controller_interval_ > 0)
+      this->poller_.add(MSG_TOUTSIDE, 0);
+  } else {
+    this->adaptive_polling_ = false;
+  }
+
+#ifdef USE_OPENTHERM_ISR_STATS
+  this->set_interval("isr_stats", 60000, [this]() { this->publishIsrStats(); });
+#endif
+
+#ifdef USE_OPENTHERM_BUS_PROFILE
+  this->set_interval("bus_profile", 60000, [this]() { this->publishBusProfile(); });
+#endif
+
+#ifdef USE_OPENTHERM_LIGHT_SLEEP
+  setupLightSleep();
+#endif
+
+  if (this->energy_interval_ > 0)
+    this->set_interval("energy", this->energy_interval_, [this]() { this->publishEnergy(); });
+
+  if (this->controller_interval_ > 0 && !this->passive_)
+    this->set_interval("controller", this->controller_interval_, [this]() { this->updateController(); });
+
+  if (this->parameter_interval_ > 0 && !this->passive_)
+    this->set_interval("parameters", this->parameter_interval_, [this]() { this->downloadParameters(); });
+
+#ifdef USE_OPENTHERM_LINE_SERVER
+  if (this->line_server_ != nullptr) {
+    this->line_server_->set_command_handler([this](const std::string &line) { return this->handleLineCommand(line); });
+    if (!this->line_server_->begin())
+      this->line_server_ = nullptr;
+  }
+#endif
+
+  if (this->use_protocol_task_) {
+    mOT.set_task(&this->task_);
+    sOT.set_task(&this->task_);
+    if (!this->task_.start(OpenThermGWClimate::protocolTask, this)) {
+      mOT.set_task(nullptr);
+      sOT.set_task(nullptr);
+    }
+  }
 }
 
 void OpenThermGWClimate::loop()
 {
-    mOT.loop();
+    if (!this->task_.is_running()) {
+      mOT.loop();
+      sOT.loop();
+      injectRequest();
+      // Only spin the main loop at full speed while a frame is in flight.
+      if (timeUntilDeadline() != OpenThermChannel::NO_DEADLINE)
+        this->high_freq_.start();
+      else
+        this->high_freq_.stop();
+    }
+
+    OpenThermTransaction transaction;
+    bool relayed = false;
+    while (this->transactions_.pop(transaction)) {
+      if (transaction.status == OpenThermResponseStatus::SUCCESS && !transaction.cached)
+        this->poller_.seen(getDataID(transaction.response), millis());
+#ifdef USE_OPENTHERM_LINE_SERVER
+      if (this->line_server_ != nullptr)
+        reportTransaction(transaction);
+#endif
+      if (transaction.source == SOURCE_REQUEST_POOL) {
+        if (transaction.status == OpenThermResponseStatus::SUCCESS)
+          processResponse(transaction.response);
+        continue;
+      }
+      if (transaction.source == SOURCE_FAILOVER) {
+        failoverAnswered(transaction);
+        continue;
+      }
+      if (transaction.source == SOURCE_WRITE_QUEUE) {
+        if (transaction.confirmed)
+          ESP_LOGD(TAG, "Boiler confirmed write of data-ID %u", getDataID(transaction.request));
+        else
+          ESP_LOGW(TAG, "Boiler did not confirm write of data-ID %u (%s)", getDataID(transaction.request),
+                   statusToString(transaction.status));
+        if (transaction.status == OpenThermResponseStatus::SUCCESS)
+          processResponse(transaction.response);
+        continue;
+      }
+
+      relayed = true;
+      thermostatSeen();
+#ifdef USE_OPENTHERM_BUS_PROFILE
+      this->polling_profile_.record(getDataID(transaction.request), transaction.time);
+#endif
+      // Thermostats start every bus cycle with a status exchange.
+      if (this->publish_interval_ == 0 && getDataID(transaction.request) == MSG_STATUS)
+        flushPublishes();
+      // Decode what the boiler was sent, overrides included.
+      processRequest(transaction.forwarded != 0 ? transaction.forwarded : transaction.request);
+      // A cached answer repeats a response that was decoded when it arrived.
+      if (transaction.status == OpenThermResponseStatus::SUCCESS && !transaction.cached)
+        processResponse(transaction.response);
+      if (this->frame_log_ != nullptr) {
+        this->frame_log_->record(false, transaction.request);
+        if (transaction.status == OpenThermResponseStatus::SUCCESS)
+          this->frame_log_->record(true, transaction.response);
+      }
+      if (this->snapshot_interval_ > 0)
+        updateSnapshot(transaction);
+    }
+
+    if (this->failover_timeout_ > 0)
+      runFailover();
+
+    if (this->frame_log_ != nullptr) {
+      // Without the protocol task a sector erase holds up the relay, so it is
+      // only done right after a thermostat request was answered: the
+      // thermostat waits at least 100 ms before the next one.
+      if (this->task_.is_running() || relayed ||
+          (this->master_mode_.load(std::memory_order_relaxed) && mOT.isIdle() && sOT.isIdle()))
+        this->frame_log_->prepare();
+      this->frame_log_->loop();
+    }
+
+    for (OpenThermAggregator *stats : {this->boiler_water_temp_stats_, this->return_water_temperature_stats_,
+                                       this->relative_modulation_level_stats_}) {
+      if (stats != nullptr)
+        stats->loop(millis());
+    }
+
+#ifdef USE_OPENTHERM_LINE_SERVER
+    if (this->line_server_ != nullptr)
+      this->line_server_->loop();
+#endif
+
+    if (this->publish_pending_ && millis() - this->publish_since_ >= this->maxPublishDelay())
+      flushPublishes();
+
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+    // Format only a few frames per iteration so logging never holds up the loop.
+    this->debug_log_.drain(4);
+#endif
+
+    // After decoding, so callbacks see entities updated with the response.
+    this->requests_.poll();
+    if (this->adaptive_polling_)
+      pollAdaptive();
+
+    uint32_t dropped = this->dropped_transactions_.exchange(0);
+    if (dropped > 0)
+      ESP_LOGW(TAG, "Dropped %" PRIu32 " transactions, main loop is falling behind", dropped);
+    uint32_t unmatched = this->unmatched_responses_.exchange(0);
+    if (unmatched > 0)
+      ESP_LOGD(TAG, "Ignored %" PRIu32 " boiler responses without a matching request", unmatched);
+
+#ifdef USE_OPENTHERM_LIGHT_SLEEP
+    updateSleepLock();
+#endif
+}
+
+void OpenThermGWClimate::on_shutdown()
+{
+    if (this->frame_log_ != nullptr)
+      this->frame_log_->flush();
+    if (this->snapshot_interval_ > 0)
+      this->snapshot_.save();
+}
+
+// Only frames that carry a value are worth restoring: values written by the
+// thermostat and values acknowledged by the boiler.
+void OpenThermGWClimate::updateSnapshot(const OpenThermTransaction &transaction)
+{
+    uint8_t stale = this->snapshot_.stale_count();
+    if (getMessageType(transaction.request) == OpenThermMessageType::WRITE_DATA)
+      this->snapshot_.update(false, transaction.request);
+    if (transaction.status == OpenThermResponseStatus::SUCCESS && !transaction.cached &&
+        getMessageType(transaction.response) == OpenThermMessageType::READ_ACK)
+      this->snapshot_.update(true, transaction.response);
+
+    if (stale > 0 && this->snapshot_.stale_count() == 0) {
+      ESP_LOGD(TAG, "All restored values have been refreshed from the bus");
+      if (this->is_restored_stale != nullptr)
+        this->is_restored_stale->publish_state(false);
+    }
+}
+
+// Sensor and climate updates are collected while frames are decoded and
+// published once per bus cycle, or once per publish interval if configured.
+void OpenThermGWClimate::publishSensor(sensor::Sensor *sensor, float value)
+{
+    uint8_t i = 0;
+    while (i < this->pending_count_ && this->pending_[i].sensor != sensor)
+      i++;
+    if (i == this->pending_count_) {
+      if (i == MAX_PENDING_PUBLISHES) {
+        sensor->publish_state(value);
+        return;
+      }
+      this->pending_[i].sensor = sensor;
+      this->pending_count_++;
+    }
+    this->pending_[i].value = value;
+    markPublishPending();
+}
+
+void OpenThermGWClimate::markPublishPending()
+{
+    if (!this->publish_pending_) {
+      this->publish_pending_ = true;
+      this->publish_since_ = millis();
+    }
+}
+
+uint32_t OpenThermGWClimate::maxPublishDelay()
+{
+    // Without an interval, fall back to a time limit in case no status frames are seen.
+    return this->publish_interval_ > 0 ? this->publish_interval_ : 2000;
+}
+
+void OpenThermGWClimate::flushPublishes()
+{
+#ifdef USE_OPENTHERM_MQTT_BATCH
+    if (this->mqtt_batch_ != nullptr)
+      this->mqtt_batch_->publish(this->state_, millis());
+    // Only the batch goes out, sensors keep their last state for all consumers.
+    if (!this->entity_updates_)
+      this->pending_count_ = 0;
+#endif
+    for (uint8_t i = 0; i < this->pending_count_; i++)
+      this->pending_[i].sensor->publish_state(this->pending_[i].value);
+    this->pending_count_ = 0;
+
+    if (this->climate_dirty_) {
+      this->climate_dirty_ = false;
+      this->publish_state();
+    }
+    this->publish_pending_ = false;
+}
+
+void OpenThermGWClimate::protocolTask(void *arg)
+{
+    auto *gw = static_cast<OpenThermGWClimate *>(arg);
+    for (;;) {
+      gw->mOT.loop();
+      gw->sOT.loop();
+      gw->injectRequest();
+      // Sleep until the ISR reports a frame or the next timeout is due.
+      uint32_t timeout_us = gw->timeUntilDeadline();
+      gw->task_.wait(timeout_us == OpenThermChannel::NO_DEADLINE ? 1000 : timeout_us / 1000 + 1);
+    }
+}
+
+uint32_t OpenThermGWClimate::timeUntilDeadline()
+{
+    return std::min(mOT.timeUntilDeadline(), sOT.timeUntilDeadline());
 }
 
 void OpenThermGWClimate::control(const climate::ClimateCall &call) {
   if (call.get_mode().has_value())
     this->mode = *call.get_mode();
-  if (call.get_target_temperature().has_value())
+  if (call.get_target_temperature().has_value()) {
     this->target_temperature = *call.get_target_temperature();
+    // Held in every relayed TRSET as well, otherwise the thermostat's next
+    // write would take the setpoint back.
+    this->room_setpoint_override_.store(temperatureToData(this->target_temperature), std::memory_order_relaxed);
+    this->writes_.write(MSG_TRSET, temperatureToData(this->target_temperature));
+  }
   //if (call.get_away().has_value())
   //    this->away = *call.get_away();
 
@@ -60,15 +390,750 @@ climate::ClimateTraits OpenThermGWClimate::traits() {
 
 void OpenThermGWClimate::dump_config() {
   LOG_CLIMATE("", "OpenTherm Gateway Climate", this);
+  ESP_LOGCONFIG(TAG, "  Protocol task: %s", YESNO(this->task_.is_running()));
+  ESP_LOGCONFIG(TAG, "  Passive: %s", YESNO(this->passive_));
+#ifdef USE_OPENTHERM_RMT
+  ESP_LOGCONFIG(TAG, "  Backend: RMT");
+#else
+  ESP_LOGCONFIG(TAG, "  Backend: GPIO");
+#endif
+#ifdef USE_OPENTHERM_LINE_SERVER
+  if (this->line_server_ != nullptr)
+    ESP_LOGCONFIG(TAG, "  Line server port: %u", this->line_server_->port());
+#endif
+#ifdef USE_OPENTHERM_METRICS
+  if (this->metrics_ != nullptr)
+    ESP_LOGCONFIG(TAG, "  Metrics path: %s", this->metrics_->path());
+#endif
+#ifdef USE_OPENTHERM_MQTT_BATCH
+  if (this->mqtt_batch_ != nullptr)
+    ESP_LOGCONFIG(TAG, "  MQTT batch topic: %s%s", this->mqtt_batch_->topic().c_str(),
+                  this->entity_updates_ ? "" : " (sensor updates disabled)");
+#endif
+#ifdef USE_OPENTHERM_LIGHT_SLEEP
+  if (this->sleep_lock_ != nullptr)
+    ESP_LOGCONFIG(TAG, "  Light sleep: awake %" PRIu32 " ms before the next request", this->sleep_margin_);
+#endif
+  if (this->controller_interval_ > 0)
+    ESP_LOGCONFIG(TAG, "  Controller interval: %" PRIu32 " ms", this->controller_interval_);
+  if (this->failover_timeout_ > 0)
+    ESP_LOGCONFIG(TAG, "  Failover timeout: %" PRIu32 " ms", this->failover_timeout_);
+  if (this->tsp_.size_known())
+    ESP_LOGCONFIG(TAG, "  Transparent slave parameters: %u", this->tsp_.size());
+  if (this->fhb_.size_known())
+    ESP_LOGCONFIG(TAG, "  Fault history buffer entries: %u", this->fhb_.size());
+  if (this->frame_log_ != nullptr)
+    ESP_LOGCONFIG(TAG, "  Frame log: %zu bytes", this->frame_log_->size());
+#ifdef USE_OPENTHERM_BUS_PROFILE
+  dumpBusProfile();
+#endif
 //  ESP_LOGCONFIG(TAG, "  Supports HEAT: %s", YESNO(this->supports_heat_));
 }
 
-void OpenThermGWClimate::processRequest(uint32_t request, OpenThermResponseStatus status) {
+// Forward a thermostat request to the boiler and its response back to the thermostat.
+// Decoding is left to the main loop so the relay never waits on entity publishing.
+void OpenThermGWClimate::relay(uint32_t request, OpenThermResponseStatus status) {
+    if (status != OpenThermResponseStatus::SUCCESS)
+      return;
+
+    OpenThermTransaction transaction;
+    transaction.request = request;
+    transaction.time = millis();
+    // Track how soon the thermostat's next request can come: follow shorter
+    // gaps at once and longer ones slowly.
+    uint32_t gap = transaction.time - this->thermostat_request_time_;
+    this->thermostat_request_time_ = transaction.time;
+    if (gap < this->thermostat_interval_)
+      this->thermostat_interval_ = gap;
+    else if (gap < MAX_THERMOSTAT_INTERVAL_MS)
+      this->thermostat_interval_ += (gap - this->thermostat_interval_) / 8;
+
+    overrideRequest(request);
+    if (request != transaction.request)
+      transaction.forwarded = request;
+    if (substituteRequest(transaction))
+      return;
+    // Never send into the delay after an injected exchange. If the bus does
+    // not free up in time the thermostat gets no answer and repeats.
+    if (sOT.waitReady(RELAY_WAIT_MS)) {
+      transaction.response = sOT.sendRequest(request);
+      transaction.status = sOT.getLastResponseStatus();
+    } else {
+      transaction.response = 0;
+      transaction.status = OpenThermResponseStatus::TIMEOUT;
+    }
+    if (transaction.status == OpenThermResponseStatus::SUCCESS)
+      mOT.sendResponse(transaction.response);
+
+    pushTransaction(transaction);
+    this->injection_slot_ = true;
+    this->injection_slot_time_ = millis();
+}
+
+// Like the OTGW firmware, send a queued request of the gateway's in place of a
+// thermostat read the boiler answered recently, and answer the thermostat from
+// the state table once the boiler has replied. The thermostat sees the same
+// timing as a relayed exchange, so its next request never finds the bus busy.
+// The status exchange and anything the gateway overrides always go through.
+bool OpenThermGWClimate::substituteRequest(const OpenThermTransaction &relayed) {
+    OpenThermMessageID id = getDataID(relayed.request);
+    if (getMessageType(relayed.request) != OpenThermMessageType::READ_DATA || id == MSG_STATUS ||
+        relayed.forwarded != 0)
+      return false;
+    OpenThermStateEntry cached = this->state_.get(id);
+    if (cached.status != OpenThermMessageType::READ_ACK || millis() - cached.timestamp > SUBSTITUTE_MAX_AGE_MS)
+      return false;
+    // Checked before a request is taken, a taken request must be sent.
+    if (!sOT.waitReady(RELAY_WAIT_MS))
+      return false;
+
+    OpenThermTransaction transaction;
+    uint8_t pool_index;
+    if (!nextInjectedRequest(transaction, pool_index))
+      return false;
+    sendInjected(transaction, pool_index);
+
+    OpenThermTransaction answered = relayed;
+    answered.response = buildResponse(OpenThermMessageType::READ_ACK, id, cached.value);
+    answered.status = OpenThermResponseStatus::SUCCESS;
+    answered.cached = true;
+    mOT.sendResponse(answered.response);
+    pushTransaction(answered);
+    return true;
+}
+
+// Send one queued request of the gateway's in the slot after a relayed
+// transaction, once the boiler bus is idle again. In master mode there is no
+// thermostat traffic, so slots are opened at a fixed pace instead.
+void OpenThermGWClimate::injectRequest() {
+    if (injectFailover())
+      return;
+    bool master_mode = this->master_mode_.load(std::memory_order_relaxed);
+    if (!this->injection_slot_) {
+      if (!master_mode || millis() - this->injection_slot_time_ < MASTER_SLOT_INTERVAL_MS)
+        return;
+      this->injection_slot_ = true;
+      this->injection_slot_time_ = millis();
+    }
+    if (millis() - this->injection_slot_time_ > INJECTION_WINDOW_MS) {
+      this->injection_slot_ = false;
+      return;
+    }
+    // The thermostat's next request is dropped if the bus is still busy
+    // RELAY_WAIT_MS after it arrives, so only start an exchange that is over
+    // by then even if the boiler never answers. With a thermostat that polls
+    // every second this leaves the gateway's requests to substituteRequest().
+    if (!master_mode && millis() - this->thermostat_request_time_ + WORST_CASE_EXCHANGE_MS >
+                            this->thermostat_interval_ + RELAY_WAIT_MS)
+      return;
+    if (!mOT.isIdle() || !sOT.isIdle())
+      return;
+
+    OpenThermTransaction transaction;
+    uint8_t pool_index;
+    if (!nextInjectedRequest(transaction, pool_index))
+      return;
+    this->injection_slot_ = false;
+    sendInjected(transaction, pool_index);
+}
+
+// Exchange a request taken by nextInjectedRequest() with the boiler and hand
+// the answer back to its source.
+void OpenThermGWClimate::sendInjected(OpenThermTransaction &transaction, uint8_t pool_index) {
+    transaction.response = sOT.sendRequest(transaction.request);
+    transaction.status = sOT.getLastResponseStatus();
+    if (transaction.source == SOURCE_WRITE_QUEUE)
+      transaction.confirmed = this->writes_.complete(transaction.request, transaction.response,
+                                                     transaction.status == OpenThermResponseStatus::SUCCESS);
+    else if (transaction.source == SOURCE_REQUEST_POOL)
+      this->requests_.complete(pool_index, transaction.response, transaction.status);
+    pushTransaction(transaction);
+}
+
+// In failover the status frame does not wait for a master slot: it goes out
+// every FAILOVER_STATUS_INTERVAL_MS as soon as the bus is free, and holds back
+// the slots until it has. The control setpoint takes the next slot.
+bool OpenThermGWClimate::injectFailover() {
+    if (!this->master_mode_.load(std::memory_order_acquire)) {
+      this->failover_tset_due_ = false;
+      return false;
+    }
+    if (millis() - this->failover_status_time_ < FAILOVER_STATUS_INTERVAL_MS)
+      return false;
+    if (!mOT.isIdle() || !sOT.isIdle())
+      return true;
+
+    OpenThermTransaction transaction;
+    transaction.source = SOURCE_FAILOVER;
+    transaction.request = this->failover_status_.load(std::memory_order_relaxed);
+    this->failover_status_time_ = millis();
+    transaction.response = sOT.sendRequest(transaction.request);
+    transaction.status = sOT.getLastResponseStatus();
+    this->failover_tset_due_ = true;
+    pushTransaction(transaction);
+    return true;
+}
+
+// The failover control setpoint goes first, then alternate between the
+// gateway's request sources so none of them starves.
+bool OpenThermGWClimate::nextInjectedRequest(OpenThermTransaction &transaction, uint8_t &pool_index) {
+    if (this->failover_tset_due_) {
+      this->failover_tset_due_ = false;
+      transaction.request = this->failover_tset_.load(std::memory_order_relaxed);
+      transaction.source = SOURCE_FAILOVER;
+      return true;
+    }
+    for (uint8_t n = 0; n < 2; n++) {
+      this->inject_turn_ = (this->inject_turn_ + 1) % 2;
+      if (this->inject_turn_ == 0 && this->writes_.next(transaction.request)) {
+        transaction.source = SOURCE_WRITE_QUEUE;
+        return true;
+      }
+      if (this->inject_turn_ == 1 && this->requests_.next(pool_index, transaction.request)) {
+        transaction.source = SOURCE_REQUEST_POOL;
+        return true;
+      }
+    }
+    return false;
+}
+
+// Walk all TSP and FHB entries in the background, one request per interval,
+// then start over after the refresh interval to pick up changes.
+void OpenThermGWClimate::downloadParameters() {
+    if (this->download_busy_)
+      return;
+    if (this->download_done_) {
+      if (millis() - this->download_done_time_ < this->parameter_refresh_interval_)
+        return;
+      this->download_done_ = false;
+      this->download_fhb_ = false;
+      this->download_index_ = -1;
+    }
+
+    uint32_t request;
+    if (this->download_index_ < 0)
+      request = (this->download_fhb_ ? frames::READ_FHB_SIZE : frames::READ_TSP).raw();
+    else
+      request = buildRequest(OpenThermMessageType::READ_DATA,
+                             this->download_fhb_ ? MSG_FHB_INDEX_FHB_VALUE : MSG_TSP_INDEX_TSP_VALUE,
+                             this->download_index_ << 8);
+
+    this->download_busy_ = this->submit(request, [this](uint32_t response, OpenThermResponseStatus status) {
+      this->download_busy_ = false;
+      // Retry the same entry on the next interval.
+      if (status != OpenThermResponseStatus::SUCCESS)
+        return;
+
+      OpenThermParameterTable &table = this->download_fhb_ ? this->fhb_ : this->tsp_;
+      if (this->download_index_ < 0 && getMessageType(response) != OpenThermMessageType::READ_ACK)
+        table.set_size(0);
+      this->download_index_++;
+      if (this->download_index_ < table.size())
+        return;
+
+      if (!this->download_fhb_) {
+        this->download_fhb_ = true;
+        this->download_index_ = -1;
+        return;
+      }
+
+      this->download_done_ = true;
+      this->download_done_time_ = millis();
+      ESP_LOGD(TAG, "Downloaded %u TSP and %u FHB entries", this->tsp_.size(), this->fhb_.size());
+      if (this->parameters_changed_) {
+        this->parameters_changed_ = false;
+        // Home Assistant keeps at most 255 characters of a state, larger
+        // tables are cut short there and only logged in full.
+        for (uint16_t first = 0; first < this->tsp_.size(); first += PARAMETERS_PER_LINE)
+          ESP_LOGD(TAG, "TSP %3u: %s", first, this->tsp_.to_hex(first, PARAMETERS_PER_LINE).c_str());
+        for (uint16_t first = 0; first < this->fhb_.size(); first += PARAMETERS_PER_LINE)
+          ESP_LOGD(TAG, "FHB %3u: %s", first, this->fhb_.to_hex(first, PARAMETERS_PER_LINE).c_str());
+        if (this->tsp_values != nullptr)
+          this->tsp_values->publish_state(this->tsp_.to_hex_limited(MAX_STATE_LENGTH));
+        if (this->fhb_values != nullptr)
+          this->fhb_values->publish_state(this->fhb_.to_hex_limited(MAX_STATE_LENGTH));
+      }
+    });
+}
+
+void OpenThermGWClimate::thermostatSeen() {
+    this->thermostat_seen_time_ = millis();
+    if (!this->failover_active_)
+      return;
+    ESP_LOGI(TAG, "Thermostat is back, relaying its requests again");
+    this->failover_active_ = false;
+    this->master_mode_.store(false, std::memory_order_relaxed);
+    if (this->is_failover_active != nullptr)
+      this->is_failover_active->publish_state(false);
+}
+
+// When the thermostat has been silent for the failover timeout, the gateway
+// keeps the boiler fed with status and control setpoint frames. Only the
+// frames are prepared here; injectFailover() sends them on its own schedule.
+void OpenThermGWClimate::runFailover() {
+    if (this->passive_)
+      return;
+    if (!this->failover_active_ && millis() - this->thermostat_seen_time_ < this->failover_timeout_)
+      return;
+
+    float setpoint = failoverSetpoint();
+    // Keep the thermostat's own master flags, but follow the climate mode for CH enable.
+    uint8_t flags = (this->thermostat_status_ & ~(1 << 0)) | (setpoint > 0 ? 1 << 0 : 0);
+    this->failover_status_.store(frames::READ_STATUS.with_value(flags << 8).raw(), std::memory_order_relaxed);
+    this->failover_tset_.store(OpenThermFrame::request(WRITE_DATA, MSG_TSET, temperatureToData(setpoint)).raw(),
+                               std::memory_order_relaxed);
+    if (this->failover_active_)
+      return;
+
+    ESP_LOGW(TAG, "No requests from the thermostat for %" PRIu32 " ms, taking over as master",
+             millis() - this->thermostat_seen_time_);
+    this->failover_active_ = true;
+    this->failover_measured_ = false;
+    // Publishes the frames above to the protocol side.
+    this->master_mode_.store(true, std::memory_order_release);
+    if (this->is_failover_active != nullptr)
+      this->is_failover_active->publish_state(true);
+}
+
+void OpenThermGWClimate::failoverAnswered(const OpenThermTransaction &transaction) {
+    if (!this->failover_active_ || transaction.status != OpenThermResponseStatus::SUCCESS)
+      return;
+    processResponse(transaction.response);
+    if (getDataID(transaction.request) != MSG_STATUS || this->failover_measured_)
+      return;
+    // Time the boiler went without a status exchange.
+    this->failover_measured_ = true;
+    uint32_t latency = millis() - this->thermostat_seen_time_;
+    ESP_LOGI(TAG, "Boiler answered the gateway %" PRIu32 " ms after the last thermostat request", latency);
+    if (this->failover_latency != nullptr)
+      this->failover_latency->publish_state(latency);
+}
+
+float OpenThermGWClimate::failoverSetpoint() {
+    if (this->mode == climate::CLIMATE_MODE_OFF)
+      return 0;
+    if (!std::isnan(this->controller_.output()))
+      return this->controller_.output();
+    // Without a thermostat there is no better estimate than what it asked for last.
+    return this->thermostat_tset_ > 0 ? this->thermostat_tset_ : this->failover_setpoint_;
+}
+
+// The controller output replaces the control setpoint written by the
+// thermostat, or feeds the boiler directly in failover.
+void OpenThermGWClimate::updateController() {
+    if (this->mode == climate::CLIMATE_MODE_OFF) {
+      this->controller_.reset();
+      this->controller_tset_.store(0, std::memory_order_relaxed);
+      return;
+    }
+    float setpoint = this->controller_.update(this->current_temperature, this->target_temperature,
+                                              this->outside_temperature_, this->controller_interval_ / 1000.0f);
+    if (std::isnan(setpoint))
+      return;
+    this->controller_tset_.store(temperatureToData(setpoint), std::memory_order_relaxed);
+    if (this->controller_setpoint != nullptr)
+      publishSensor(this->controller_setpoint, setpoint);
+}
+
+#ifdef USE_OPENTHERM_LINE_SERVER
+void OpenThermGWClimate::reportTransaction(const OpenThermTransaction &transaction) {
+    if (transaction.source == SOURCE_RELAYED) {
+      this->line_server_->send_frame('T', transaction.request);
+      if (transaction.forwarded != 0)
+        this->line_server_->send_frame('R', transaction.forwarded);
+    } else {
+      this->line_server_->send_frame('R', transaction.request);
+    }
+    // 'A' marks an answer the gateway gave the thermostat itself.
+    if (transaction.status == OpenThermResponseStatus::SUCCESS)
+      this->line_server_->send_frame(transaction.cached ? 'A' : 'B', transaction.response);
+}
+
+// Subset of the OTGW serial commands, all of the form "XX=value".
+std::string OpenThermGWClimate::handleLineCommand(const std::string &line) {
+    if (line.size() < 3 || line[2] != '=')
+      return "SE";
+    std::string command = line.substr(0, 2);
+    std::string argument = line.substr(3);
+
+    if (command == "PR") {
+      if (argument == "A")
+        return "PR: A=OpenTherm Gateway ESPHome";
+      if (argument == "M")
+        return this->failover_active_ ? "PR: M=M" : "PR: M=G";
+      return "BV";
+    }
+
+    optional<float> value = parse_number<float>(argument);
+    if (!value.has_value())
+      return "BV";
+    float v = *value;
+    if (command == "TT" || command == "TC") {
+      // Both hold the setpoint until cancelled with 0.
+      if (v == 0) {
+        this->room_setpoint_override_.store(0, std::memory_order_relaxed);
+      } else {
+        if (v < 1 || v > 30)
+          return "OR";
+        auto call = this->make_call();
+        call.set_target_temperature(v);
+        call.perform();
+      }
+    } else if (command == "SW") {
+      if (v < 0 || v > 90)
+        return "OR";
+      this->set_dhw_setpoint(v);
+    } else if (command == "SH") {
+      if (v < 0 || v > 90)
+        return "OR";
+      this->set_max_ch_water_setpoint(v);
+    } else if (command == "MM") {
+      if (v < 0 || v > 100)
+        return "OR";
+      this->set_max_relative_modulation_level(v);
+    } else {
+      return "NG";
+    }
+
+    char reply[16];
+    snprintf(reply, sizeof(reply), "%s: %.2f", command.c_str(), v);
+    return reply;
+}
+#endif
+
+#ifdef USE_OPENTHERM_BUS_PROFILE
+// Bus load of the last interval per channel, and the mean request interval
+// of every data-ID the thermostat uses.
+void OpenThermGWClimate::publishBusProfile() {
+    uint32_t now = millis();
+    uint32_t elapsed = now - this->bus_profile_time_;
+    this->bus_profile_time_ = now;
+    OpenThermChannel *channels[2] = {&mOT, &sOT};
+    sensor::Sensor *loads[2] = {this->thermostat_bus_load, this->boiler_bus_load};
+    for (uint8_t i = 0; i < 2; i++) {
+      uint64_t busy = channels[i]->getBusProfile().busy_us();
+      uint32_t added = busy - this->bus_busy_seen_us_[i];
+      this->bus_busy_seen_us_[i] = busy;
+      if (loads[i] != nullptr && elapsed > 0)
+        loads[i]->publish_state(added / (elapsed * 10.0f));
+    }
+
+    if (this->polling_profile == nullptr)
+      return;
+    char buf[256];
+    size_t len = 0;
+    for (uint8_t i = 0; i < this->polling_profile_.size() && len < sizeof(buf) - 1; i++) {
+      const OpenThermPollingProfile::Entry &entry = this->polling_profile_.entry(i);
+      if (entry.mean_interval_ms() > 0)
+        len += snprintf(buf + len, sizeof(buf) - len, "%s%u:%.1f", len > 0 ? " " : "", entry.id,
+                        entry.mean_interval_ms() / 1000.0f);
+    }
+    buf[std::min(len, sizeof(buf) - 1)] = '\0';
+    this->polling_profile->publish_state(buf);
+}
+
+void OpenThermGWClimate::dumpBusProfile() {
+    uint32_t uptime = millis();
+    OpenThermChannel *channels[2] = {&mOT, &sOT};
+    for (uint8_t i = 0; i < 2; i++) {
+      const OpenThermBusProfile &profile = channels[i]->getBusProfile();
+      uint64_t busy = profile.busy_us();
+      ESP_LOGCONFIG(TAG, "  %s bus: %" PRIu32 " frames, busy %.2f%% since boot",
+                    i == 0 ? "Thermostat" : "Boiler", profile.frames(), uptime > 0 ? busy / (uptime * 10.0) : 0.0);
+      ESP_LOGCONFIG(TAG,
+                    "    Idle gaps <25/50/100/200/400/800/1600/more ms: %" PRIu32 "/%" PRIu32 "/%" PRIu32
+                    "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32,
+                    profile.gaps(0), profile.gaps(1), profile.gaps(2), profile.gaps(3), profile.gaps(4),
+                    profile.gaps(5), profile.gaps(6), profile.gaps(7));
+    }
+    ESP_LOGCONFIG(TAG, "  Thermostat data-IDs: %u, untracked requests: %" PRIu32,
+                  this->polling_profile_.size(), this->polling_profile_.overflow());
+    for (uint8_t i = 0; i < this->polling_profile_.size(); i++) {
+      const OpenThermPollingProfile::Entry &entry = this->polling_profile_.entry(i);
+      const OpenThermMessageInfo *info = getMessageInfo(entry.id);
+      if (entry.count > 1)
+        ESP_LOGCONFIG(TAG, "    %3u %-24s %6" PRIu32 " requests, every %.1f s (%.1f-%.1f)", entry.id,
+                      info != nullptr ? info->name : "?", entry.count, entry.mean_interval_ms() / 1000.0f,
+                      entry.min_interval_ms / 1000.0f, entry.max_interval_ms / 1000.0f);
+      else
+        ESP_LOGCONFIG(TAG, "    %3u %-24s %6" PRIu32 " requests", entry.id, info != nullptr ? info->name : "?",
+                      entry.count);
+    }
+}
+#endif
+
+#ifdef USE_OPENTHERM_LIGHT_SLEEP
+// The CPU drops into automatic light sleep whenever every task is idle and
+// nobody holds a no-light-sleep lock. The gateway holds its lock while a frame
+// is in flight and from sleep_margin_ before the next request is due, so
+// requests the thermostat sends on its usual schedule are decoded by the edge
+// interrupt as usual. A frame that starts early wakes the CPU through the GPIO
+// wakeup instead, see lightSleepExit().
+void OpenThermGWClimate::setupLightSleep() {
+    esp_pm_config_t pm_config{};
+    // Frequency scaling would slow down the edge interrupt, only sleep.
+    pm_config.max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    pm_config.min_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ;
+    pm_config.light_sleep_enable = true;
+    esp_pm_sleep_cbs_register_config_t callbacks{};
+    callbacks.enter_cb = OpenThermGWClimate::lightSleepEnter;
+    callbacks.exit_cb = OpenThermGWClimate::lightSleepExit;
+    callbacks.enter_cb_user_arg = this;
+    callbacks.exit_cb_user_arg = this;
+    if (esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "opentherm", &this->sleep_lock_) != ESP_OK ||
+        esp_pm_lock_acquire(this->sleep_lock_) != ESP_OK || esp_pm_light_sleep_register_cbs(&callbacks) != ESP_OK ||
+        esp_pm_configure(&pm_config) != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to enable automatic light sleep");
+      this->sleep_lock_ = nullptr;
+      return;
+    }
+    this->sleep_locked_ = true;
+    // Keep the crystal running so a start bit is caught well within its first half.
+    esp_sleep_pd_config(ESP_PD_DOMAIN_XTAL, ESP_PD_OPTION_ON);
+    esp_sleep_enable_gpio_wakeup();
+    this->sleep_stats_time_ = micros();
+    this->set_interval("light_sleep", 60000, [this]() { this->publishSleepStats(); });
+}
+
+void OpenThermGWClimate::updateSleepLock() {
+    if (this->sleep_lock_ == nullptr)
+      return;
+    uint32_t now = millis();
+    bool awake = this->injection_slot_ || timeUntilDeadline() != OpenThermChannel::NO_DEADLINE;
+    if (this->master_mode_.load(std::memory_order_relaxed)) {
+      // The gateway's own requests are due at a fixed pace.
+      uint32_t since_slot = now - this->injection_slot_time_;
+      uint32_t since_status = now - this->failover_status_time_;
+      awake = awake || since_slot + this->sleep_margin_ >= MASTER_SLOT_INTERVAL_MS ||
+              since_status + this->sleep_margin_ >= FAILOVER_STATUS_INTERVAL_MS;
+    } else {
+      // Stay awake from shortly before the thermostat's next request until it
+      // arrives, and throughout until its pace is known.
+      awake = awake || this->thermostat_interval_ == 0 ||
+              now - this->thermostat_request_time_ + this->sleep_margin_ >= this->thermostat_interval_;
+    }
+    if (awake == this->sleep_locked_)
+      return;
+    if (awake)
+      esp_pm_lock_acquire(this->sleep_lock_);
+    else
+      esp_pm_lock_release(this->sleep_lock_);
+    this->sleep_locked_ = awake;
+}
+
+// Called by the idle task right before and after each light sleep, with
+// interrupts disabled. The GPIO wakeup needs the inputs in level mode, so
+// their edge interrupt is only off while the CPU actually sleeps.
+esp_err_t OpenThermGWClimate::lightSleepEnter(int64_t sleep_time_us, void *arg) {
+    auto *self = static_cast<OpenThermGWClimate *>(arg);
+    self->mOT.enableWakeup();
+    self->sOT.enableWakeup();
+    self->sleep_start_ = micros();
+    return ESP_OK;
+}
+
+esp_err_t OpenThermGWClimate::lightSleepExit(int64_t sleep_time_us, void *arg) {
+    auto *self = static_cast<OpenThermGWClimate *>(arg);
+    bool woken_by_bus = esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_GPIO;
+    bool started = self->mOT.resumeFromSleep();
+    started = self->sOT.resumeFromSleep() || started;
+    self->asleep_us_.fetch_add(micros() - self->sleep_start_, std::memory_order_relaxed);
+    // Woken by an input that was already back at idle: the first half of the
+    // start bit was over before the decoder could see it.
+    if (woken_by_bus && !started)
+      self->missed_start_bits_.fetch_add(1, std::memory_order_relaxed);
+    return ESP_OK;
+}
+
+void OpenThermGWClimate::publishSleepStats() {
+    uint32_t now = micros();
+    uint32_t elapsed = now - this->sleep_stats_time_;
+    uint32_t asleep = this->asleep_us_.exchange(0, std::memory_order_relaxed);
+    float awake = elapsed > 0 ? 100.0f * (1.0f - (float) asleep / elapsed) : 100.0f;
+    this->sleep_stats_time_ = now;
+    ESP_LOGD(TAG, "Awake %.1f%% of the time", awake);
+    uint32_t missed = this->missed_start_bits_.exchange(0, std::memory_order_relaxed) + mOT.takeMissedStartBits() +
+                      sOT.takeMissedStartBits();
+    if (missed > 0)
+      ESP_LOGW(TAG, "Woke up too late for the start bit of %" PRIu32 " frames", missed);
+    if (this->awake_ratio != nullptr)
+      this->awake_ratio->publish_state(awake);
+}
+#endif
+
+#ifdef USE_OPENTHERM_ISR_STATS
+void OpenThermGWClimate::publishIsrStats() {
+    uint32_t max_duration = 0;
+    uint32_t max_edge_error = 0;
+    for (OpenThermChannel *channel : {&mOT, &sOT}) {
+      OpenThermIsrStats stats = channel->takeIsrStats();
+      if (stats.calls == 0)
+        continue;
+      const char *name = channel == &mOT ? "thermostat" : "boiler";
+      ESP_LOGD(TAG,
+               "%s ISR: %" PRIu32 " calls, %" PRIu32 "-%" PRIu32 " us, <1/2/4/8/16/32/64/more us: %" PRIu32
+               "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32,
+               name, stats.calls, stats.minDurationUs, stats.maxDurationUs, stats.duration[0], stats.duration[1],
+               stats.duration[2], stats.duration[3], stats.duration[4], stats.duration[5], stats.duration[6],
+               stats.duration[7]);
+      ESP_LOGD(TAG,
+               "%s edges: %" PRIu32 ", max error %" PRIu32 " us, per %" PRIu32 " us: %" PRIu32 "/%" PRIu32
+               "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32 "/%" PRIu32,
+               name, stats.edges, stats.maxEdgeErrorUs, OpenThermIsrStats::EDGE_BUCKET_US, stats.edgeError[0], stats.edgeError[1],
+               stats.edgeError[2], stats.edgeError[3], stats.edgeError[4], stats.edgeError[5], stats.edgeError[6],
+               stats.edgeError[7]);
+      max_duration = std::max(max_duration, stats.maxDurationUs);
+      max_edge_error = std::max(max_edge_error, stats.maxEdgeErrorUs);
+    }
+    if (this->isr_max_duration != nullptr)
+      this->isr_max_duration->publish_state(max_duration);
+    if (this->isr_max_edge_error != nullptr)
+      this->isr_max_edge_error->publish_state(max_edge_error);
+}
+#endif
+
+void OpenThermGWClimate::publishEnergy() {
+    if (this->burner_hours != nullptr)
+      this->burner_hours->publish_state(this->energy_.flame_hours());
+    if (this->ch_hours != nullptr)
+      this->ch_hours->publish_state(this->energy_.ch_hours());
+    if (this->dhw_hours != nullptr)
+      this->dhw_hours->publish_state(this->energy_.dhw_hours());
+    if (this->full_load_hours != nullptr)
+      this->full_load_hours->publish_state(this->energy_.full_load_hours());
+    float duty_cycle = this->energy_.take_duty_cycle();
+    if (this->burner_duty_cycle != nullptr)
+      this->burner_duty_cycle->publish_state(duty_cycle);
+}
+
+void OpenThermGWClimate::pollAdaptive() {
+    uint8_t id;
+    if (this->poll_busy_ || !this->poller_.next(millis(), id))
+      return;
+    this->poll_busy_ = this->submit(buildRequest(OpenThermMessageType::READ_DATA, (OpenThermMessageID) id, 0),
+                                    [this, id](uint32_t response, OpenThermResponseStatus status) {
+      this->poll_busy_ = false;
+      // Successful responses reset the timer when decoded; back off on failures too.
+      if (status != OpenThermResponseStatus::SUCCESS)
+        this->poller_.seen(id, millis());
+    });
+}
+
+bool OpenThermGWClimate::submit(uint32_t request, OpenThermRequestCallback &&callback, uint32_t timeout_ms) {
+    if (this->passive_)
+      return false;
+    return this->requests_.submit(request, std::move(callback), timeout_ms);
+}
+
+void OpenThermGWClimate::set_dhw_setpoint(float dhw_setpoint) {
+    this->dhw_setpoint = dhw_setpoint;
+    this->dhw_setpoint_override_.store(temperatureToData(dhw_setpoint), std::memory_order_relaxed);
+    this->writes_.write(MSG_TDHWSET, temperatureToData(dhw_setpoint));
+}
+
+void OpenThermGWClimate::set_max_ch_water_setpoint(float max_ch_water_setpoint) {
+    this->max_ch_water_setpoint = max_ch_water_setpoint;
+    this->max_ch_setpoint_override_.store(temperatureToData(max_ch_water_setpoint), std::memory_order_relaxed);
+    this->writes_.write(MSG_MAXTSET, temperatureToData(max_ch_water_setpoint));
+}
+
+void OpenThermGWClimate::set_max_relative_modulation_level(float max_relative_modulation_level) {
+    this->max_relative_modulation_level = max_relative_modulation_level;
+    this->max_modulation_override_.store(temperatureToData(max_relative_modulation_level), std::memory_order_relaxed);
+}
+
+void OpenThermGWClimate::pushTransaction(const OpenThermTransaction &transaction) {
+    if (transaction.status == OpenThermResponseStatus::SUCCESS && !transaction.cached)
+      this->state_.update(transaction.response, millis());
+#ifdef USE_OPENTHERM_METRICS
+    this->counters_.status[transaction.status].fetch_add(1, std::memory_order_relaxed);
+#endif
+    if (!this->transactions_.push(transaction)) {
+      this->dropped_transactions_++;
+#ifdef USE_OPENTHERM_METRICS
+      this->counters_.dropped.fetch_add(1, std::memory_order_relaxed);
+#endif
+    }
+}
+
+// In passive mode the thermostat talks to the boiler directly; both lines are
+// only decoded. A request stays pending until the boiler answers it with the
+// same data-ID, or until it is superseded by the next request.
+void OpenThermGWClimate::sniffRequest(uint32_t request, OpenThermResponseStatus status) {
+    if (this->sniffed_request_pending_) {
+      this->sniffed_.status = OpenThermResponseStatus::TIMEOUT;
+      pushTransaction(this->sniffed_);
+      this->sniffed_request_pending_ = false;
+    }
+    if (status != OpenThermResponseStatus::SUCCESS)
+      return;
+
+    this->sniffed_.request = request;
+    this->sniffed_.response = 0;
+    this->sniffed_request_time_ = millis();
+    this->sniffed_.time = this->sniffed_request_time_;
+    this->sniffed_request_pending_ = true;
+}
+
+void OpenThermGWClimate::sniffResponse(uint32_t response, OpenThermResponseStatus status) {
+    if (status != OpenThermResponseStatus::SUCCESS)
+      return;
+    if (!this->sniffed_request_pending_ || getDataID(response) != getDataID(this->sniffed_.request) ||
+        millis() - this->sniffed_request_time_ > 1000) {
+      this->unmatched_responses_++;
+      return;
+    }
+
+    this->sniffed_.response = response;
+    this->sniffed_.status = status;
+    pushTransaction(this->sniffed_);
+    this->sniffed_request_pending_ = false;
+}
+
+// Replace values sent by the thermostat with the ones configured on the gateway.
+void OpenThermGWClimate::overrideRequest(uint32_t &request) {
+    switch (getDataID(request)) {
+      case MSG_MAX_REL_MOD_LEVEL_SETTING: {
+        int32_t max_modulation = this->max_modulation_override_.load(std::memory_order_relaxed);
+        if (max_modulation >= 0)
+          request = modifyMsgData(request, max_modulation);
+        break;
+      }
+      case MSG_TRSET: {
+        uint16_t room_setpoint = this->room_setpoint_override_.load(std::memory_order_relaxed);
+        if (room_setpoint != 0 && getMessageType(request) == OpenThermMessageType::WRITE_DATA)
+          request = modifyMsgData(request, room_setpoint);
+        break;
+      }
+      case MSG_TDHWSET: {
+        int32_t dhw_setpoint = this->dhw_setpoint_override_.load(std::memory_order_relaxed);
+        if (dhw_setpoint >= 0 && getMessageType(request) == OpenThermMessageType::WRITE_DATA)
+          request = modifyMsgData(request, dhw_setpoint);
+        break;
+      }
+      case MSG_TSET: {
+        uint16_t controller_tset = this->controller_tset_.load(std::memory_order_relaxed);
+        if (controller_tset != 0 && getMessageType(request) == OpenThermMessageType::WRITE_DATA)
+          request = modifyMsgData(request, controller_tset);
+        break;
+      }
+      case MSG_MAXTSET: {
+        int32_t max_ch_setpoint = this->max_ch_setpoint_override_.load(std::memory_order_relaxed);
+        if (max_ch_setpoint >= 0 && getMessageType(request) == OpenThermMessageType::WRITE_DATA)
+          request = modifyMsgData(request, max_ch_setpoint);
+        break;
+      }
+      default:
+        break;
+    }
+}
 
+void OpenThermGWClimate::processRequest(uint32_t request) {
     // master/thermostat request
     OpenThermMessageID id = getDataID(request);
-    uint16_t data = getUInt16(request);
-    //ESP_LOGD(TAG, "T %03d %04x", id, data);
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+    this->debug_log_.push(false, request, millis());
+#endif
 
     switch (id) {
       case MSG_DATE:
@@ -129,18 +1194,14 @@ void OpenThermGWClimate::processRequest(uint32_t request, OpenThermResponseStatu
         //ESP_LOGD(TAG, "Request %d not handled!", id);
         break;
     }
-
-    uint32_t response = sOT.sendRequest(request);
-    status = sOT.getLastResponseStatus();
-    processResponse(response, status);
 }
 
-void OpenThermGWClimate::processResponse(uint32_t &response, OpenThermResponseStatus status) {
-
+void OpenThermGWClimate::processResponse(uint32_t response) {
     // slave/boiler response
     OpenThermMessageID id = getDataID(response);
-    uint16_t data = getUInt16(response);
-    //ESP_LOGD(TAG, "B %03d %04x", id, data);
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+    this->debug_log_.push(true, response, millis());
+#endif
     switch (id) {
       case MSG_BURNER_STARTS:
         process_Slave_MSG_BURNER_STARTS(response);
@@ -272,8 +1333,6 @@ void OpenThermGWClimate::processResponse(uint32_t &response, OpenThermResponseSt
         //ESP_LOGD(TAG, "Response %d not handled!", id);
         break;
     }
-
-    mOT.sendResponse(response);
 }
 
 
@@ -297,11 +1356,7 @@ void OpenThermGWClimate::process_Master_MSG_STATUS(uint32_t &request) {
 
     // The CH enabled bit has priority over the Control Setpoint. The master can indicate that no CH demand is
     // required by putting the CH enabled bit = 0 (ie CH is disabled), even if the Control Setpoint is non-zero.
-    bool master_ch_enabled      = ub & (1 << 0);
-    bool master_dhw_enabled     = ub & (1 << 1);
-    bool master_cooling_enabled = ub & (1 << 2);
-    bool master_otc_enabled     = ub & (1 << 3);
-    bool master_ch2_enabled     = ub & (1 << 4);
+    this->thermostat_status_ = ub;
 
     //ESP_LOGD(TAG, "master_ch_enabled: %s", YESNO(master_ch_enabled));
     //ESP_LOGD(TAG, "master_dhw_enabled: %s", YESNO(master_dhw_enabled));
@@ -310,7 +1365,6 @@ void OpenThermGWClimate::process_Master_MSG_STATUS(uint32_t &request) {
     //ESP_LOGD(TAG, "master_ch2_enabled: %s", YESNO(master_ch2_enabled));
 
     //if (this->away) {
-
     //}
 }
 
@@ -324,6 +1378,9 @@ void OpenThermGWClimate::process_Slave_MSG_STATUS(uint32_t &response) {
     bool slave_cooling_active   = lb & (1 << 4);
     bool slave_ch2_active       = lb & (1 << 5);
     bool slave_diagnostic_event = lb & (1 << 6);
+    this->poller_.set_status(lb);
+    if (this->energy_interval_ > 0)
+      this->energy_.update_status(millis(), slave_flame_on, slave_ch_active, slave_dhw_active);
 
     //ESP_LOGD(TAG, "slave_fault_indication: %s", YESNO(slave_fault_indication));
     //ESP_LOGD(TAG, "slave_ch_active: %s", YESNO(slave_ch_active));
@@ -366,7 +1423,8 @@ void OpenThermGWClimate::process_Slave_MSG_STATUS(uint32_t &response) {
 // #1: Control setpoint ie CH water temperature setpoint (°C)
 void OpenThermGWClimate::process_Master_MSG_TSET(uint32_t &request) {
     float control_setpoint = getFloat(request);
-    ESP_LOGD(TAG, "CH water temperature setpoint (°C): %f", control_setpoint);
+    if (getMessageType(request) == OpenThermMessageType::WRITE_DATA)
+      this->thermostat_tset_ = control_setpoint;
     if (control_setpoint != this->target_temperature) {
       //request = modifyMsgData(request, temperatureToData(this->target_temperature));
     }
@@ -374,15 +1432,8 @@ void OpenThermGWClimate::process_Master_MSG_TSET(uint32_t &request) {
 
 // #5: Application-specific flags
 void OpenThermGWClimate::process_Slave_MSG_ASF_FLAGS_OEM_FAULT_CODE(uint32_t &response) {
-    uint8_t ub = getUBUInt8(response);
-    uint8_t oem_fault_code = getLBUInt8(response);
-
-    bool slave_service_request = ub & (1 << 0); // service not req’d, service required
-    bool slave_lockout_reset   = ub & (1 << 1); // remote reset disabled, rr enabled
-    bool slave_low_water_press = ub & (1 << 2); // no WP fault, water pressure fault
-    bool slave_gas_flame_fault = ub & (1 << 3); // no G/F fault, gas/flame fault
-    bool slave_air_press_fault = ub & (1 << 4); // no AP fault, air pressure fault
-    bool slave_water_over_temp = ub & (1 << 5); // no OvT fault, over-temperature fault
+    // Fault flags in the high byte, OEM fault code in the low byte; the frame
+    // log spells out the flags, see describeValue().
 }
 
 // #8: Control setpoint for 2nd CH circuit (°C)
@@ -393,14 +1444,10 @@ void OpenThermGWClimate::process_Master_MSG_TSETCH2(uint32_t &request) {
     temperature = 0.0f;
   if (temperature > 100.0f)
     temperature = 100.0f;*/
-    float control_setpoint = getFloat(request);
-    ESP_LOGD(TAG, "Control setpoint for 2nd CH circuit (°C): %f", control_setpoint);
 }
 
 // #115: OEM diagnostic code
 void OpenThermGWClimate::process_Slave_MSG_OEM_DIAGNOSTIC_CODE(uint32_t &request) {
-    uint16_t oem_diagnostic_code = getUInt16(request);
-    ESP_LOGD(TAG, "oem_diagnostic_code: %d", oem_diagnostic_code);
 }
 
 /** Class 2 : Configuration Information **/
@@ -411,57 +1458,28 @@ void OpenThermGWClimate::process_Slave_MSG_OEM_DIAGNOSTIC_CODE(uint32_t &request
 
 // #2: Master configuration & Master MemberID code
 void OpenThermGWClimate::process_Master_MSG_M_CONFIG_M_MEMBERIDCODE(uint32_t &response) {
-    uint8_t master_configuration = getUBUInt8(response);
-
-    // Remeha = 11
-    uint8_t master_memberid_code = getLBUInt8(response);
-    ESP_LOGD(TAG, "master_memberid_code: %d", master_memberid_code);
+    // MemberID code in the low byte, e.g. Remeha = 11
 }
 
 // #3: Slave configuration & Slave MemberID code
 void OpenThermGWClimate::process_Slave_MSG_S_CONFIG_S_MEMBERIDCODE(uint32_t &request) {
-    uint8_t slave_configuration = getUBUInt8(request);
-    uint8_t slave_member_id_code = getLBUInt8(request);
-
-    bool slave_dhw_present                   = slave_configuration & (1 << 0); // dhw not present, dhw is present
-    bool slave_control_type                  = slave_configuration & (1 << 1); // modulating, on/off
-    bool slave_cooling_config                = slave_configuration & (1 << 2); // cooling not supported, cooling supported
-    bool slave_dhw_config                    = slave_configuration & (1 << 3); // instantaneous or not-specified, storage tank
-    bool slave_low_off_pump_control_function = slave_configuration & (1 << 4); // allowed, not allowed
-    bool slave_ch2_present                   = slave_configuration & (1 << 5); // CH2 not present, CH2 present
-
-    ESP_LOGD(TAG, "slave_dhw_present: %s", YESNO(slave_dhw_present));
-    ESP_LOGD(TAG, "slave_control_type: %s", YESNO(slave_control_type));
-    ESP_LOGD(TAG, "slave_cooling_config: %s", YESNO(slave_cooling_config));
-    ESP_LOGD(TAG, "slave_dhw_config: %s", YESNO(slave_dhw_config));
-    ESP_LOGD(TAG, "slave_low_off_pump_control_function: %s", YESNO(slave_low_off_pump_control_function));
-    ESP_LOGD(TAG, "slave_ch2_present: %s", YESNO(slave_ch2_present));
+    // Configuration flags in the high byte, decoded by describeValue().
 }
 
 // #124: OpenTherm version Master
 void OpenThermGWClimate::process_Master_MSG_OPENTHERM_VERSION_MASTER(uint32_t &response) {
-    uint16_t opentherm_version_master = getUInt16(response);
-    ESP_LOGD(TAG, "opentherm_version_master: %d", opentherm_version_master);
 }
 
 // #125: OpenTherm version Slave
 void OpenThermGWClimate::process_Slave_MSG_OPENTHERM_VERSION_SLAVE(uint32_t &request) {
-    uint16_t opentherm_version_slave = getUInt16(request);
-    ESP_LOGD(TAG, "opentherm_version_slave: %d", opentherm_version_slave);
 }
 
 // #126: Master product version number and type
 void OpenThermGWClimate::process_Master_MSG_MASTER_VERSION(uint32_t &request) {
-    uint8_t product_type = getUBUInt8(request);
-    uint8_t product_version = getLBUInt8(request);
-    ESP_LOGD(TAG, "master product type/version: %d/%d", product_type, product_version);
 }
 
 // #127: Slave product version number and type
 void OpenThermGWClimate::process_Slave_MSG_SLAVE_VERSION(uint32_t &response) {
-    uint8_t product_type = getUBUInt8(response);
-    uint8_t product_version = getLBUInt8(response);
-    ESP_LOGD(TAG, "slave product type/version: %d/%d", product_type, product_version);
 }
 
 /* Class 3 : Remote Commands */
@@ -470,14 +1488,10 @@ void OpenThermGWClimate::process_Slave_MSG_SLAVE_VERSION(uint32_t &response) {
 
 // #4: HB: Command-Code
 void OpenThermGWClimate::process_Master_MSG_COMMAND(uint32_t &request) {
-    uint8_t command_code = getUBUInt8(request);
-    ESP_LOGD(TAG, "master command code: %d", command_code);
 }
 
 // #4: Cmd-Response-Code
 void OpenThermGWClimate::process_Slave_MSG_COMMAND(uint32_t &response) {
-    uint8_t product_version = getLBUInt8(response);
-    ESP_LOGD(TAG, "slave product_version: %d", product_version);
 }
 
 /* Class 4 : Sensor and Informational Data */
@@ -487,241 +1501,217 @@ void OpenThermGWClimate::process_Slave_MSG_COMMAND(uint32_t &response) {
 // #16: Room Setpoint
 void OpenThermGWClimate::process_Master_MSG_TRSET(uint32_t &request) {
     float room_setpoint = getFloat(request);
-    ESP_LOGD(TAG, "room_setpoint: %f", room_setpoint);
     if (this->target_temperature != room_setpoint) {
       this->target_temperature = room_setpoint;
-      this->publish_state();
+      this->climate_dirty_ = true;
+      markPublishPending();
     }
 }
 
 // #17: Relative Modulation Level
 void OpenThermGWClimate::process_Slave_MSG_REL_MOD_LEVEL(uint32_t &response) {
     float relative_modulation_level = getFloat(response);
-    ESP_LOGD(TAG, "relative_modulation_level: %f", relative_modulation_level);
+    if (this->energy_interval_ > 0 && getMessageType(response) == OpenThermMessageType::READ_ACK)
+      this->energy_.update_modulation(millis(), getUInt16(response));
+    if (this->relative_modulation_level_stats_ != nullptr && getMessageType(response) == OpenThermMessageType::READ_ACK)
+      this->relative_modulation_level_stats_->add(relative_modulation_level);
     if (this->relative_modulation_level != nullptr) {
-      this->relative_modulation_level->publish_state(relative_modulation_level);
+      publishSensor(this->relative_modulation_level, relative_modulation_level);
     }
 }
 
 // #18: Water pressure of the boiler CH circuit (bar)
 void OpenThermGWClimate::process_Slave_MSG_CH_PRESSURE(uint32_t &response) {
     float ch_water_pressure = getFloat(response);
-    ESP_LOGD(TAG, "ch_water_pressure: %f bar", ch_water_pressure);
     if (this->ch_water_pressure != nullptr) {
-      this->ch_water_pressure->publish_state(ch_water_pressure);
+      publishSensor(this->ch_water_pressure, ch_water_pressure);
     }
 }
 
 // #19: Water flow rate through the DHW circuit (l/min)
 void OpenThermGWClimate::process_Slave_MSG_DHW_FLOW_RATE(uint32_t &response) {
     float dhw_flow_rate = getFloat(response);
-    ESP_LOGD(TAG, "dhw_flow_rate: %f l/min", dhw_flow_rate);
     if (this->dhw_flow_rate != nullptr) {
-      this->dhw_flow_rate->publish_state(dhw_flow_rate);
+      publishSensor(this->dhw_flow_rate, dhw_flow_rate);
     }
 }
 
 // #20: Day of Week & Time of Day
 void OpenThermGWClimate::process_Master_MSG_DAY_TIME(uint32_t &msg) {
-    uint8_t ub = getUBUInt8(msg);
-    uint8_t minutes = getLBUInt8(msg);
-    uint8_t day_of_week = (ub >> 5) & 7;
-    uint8_t hours = (ub & 0x1f);
+    // Day of week, hours and minutes, decoded by describeValue().
 }
 
 void OpenThermGWClimate::process_Slave_MSG_DAY_TIME(uint32_t &msg) {
-    uint8_t ub = getUBUInt8(msg);
-    uint8_t minutes = getLBUInt8(msg);
-    uint8_t day_of_week = (ub >> 5) & 7;
-    uint8_t hours = (ub & 0x1f);
 }
 
 // #21: Date
 void OpenThermGWClimate::process_Master_MSG_DATE(uint32_t &msg) {
-    uint8_t month = getUBUInt8(msg);
-    uint8_t day_of_month = getLBUInt8(msg);
+    // Month and day of month, decoded by describeValue().
 }
 
 void OpenThermGWClimate::process_Slave_MSG_DATE(uint32_t &msg) {
-    uint8_t month = getUBUInt8(msg);
-    uint8_t day_of_month = getLBUInt8(msg);
 }
 
 // #22: Year
 void OpenThermGWClimate::process_Master_MSG_YEAR(uint32_t &msg) {
-    uint16_t year = getUInt16(msg);
 }
 
 void OpenThermGWClimate::process_Slave_MSG_YEAR(uint32_t &msg) {
-    uint16_t year = getUInt16(msg);
 }
 
 // #23: Current room setpoint for 2nd CH circuit (°C)
 void OpenThermGWClimate::process_Master_MSG_TRSETCH2(uint32_t &request) {
-    float room_setpoint_ch2 = getFloat(request);
-    ESP_LOGD(TAG, "room_setpoint_ch2: %f", room_setpoint_ch2);
 }
 
 // #24: Current sensed room temperature (°C)
 void OpenThermGWClimate::process_Master_MSG_TR(uint32_t &request) {
     float room_temperature = getFloat(request);
-    ESP_LOGD(TAG, "room_temperature: %f", room_temperature);
     if (this->current_temperature != room_temperature) {
       this->current_temperature = room_temperature;
-      this->publish_state();
+      this->climate_dirty_ = true;
+      markPublishPending();
     }
 }
 
 // #25: Flow water temperature from boiler (°C)
 void OpenThermGWClimate::process_Slave_MSG_TBOILER(uint32_t &response) {
     float boiler_water_temp = getFloat(response);
-    ESP_LOGD(TAG, "boiler_water_temp: %f", boiler_water_temp);
+    if (this->boiler_water_temp_stats_ != nullptr && getMessageType(response) == OpenThermMessageType::READ_ACK)
+      this->boiler_water_temp_stats_->add(boiler_water_temp);
     if (this->boiler_water_temp != nullptr) {
-      this->boiler_water_temp->publish_state(boiler_water_temp);
+      publishSensor(this->boiler_water_temp, boiler_water_temp);
     }
 }
 
 // #26: Domestic hot water temperature (°C)
 void OpenThermGWClimate::process_Slave_MSG_TDHW(uint32_t &response) {
     float dhw_temperature = getFloat(response);
-    ESP_LOGD(TAG, "dhw_temperature: %f", dhw_temperature);
     if (this->dhw_temperature != nullptr) {
-      this->dhw_temperature->publish_state(dhw_temperature);
+      publishSensor(this->dhw_temperature, dhw_temperature);
     }
 }
 
 // #27: Outside air temperature (°C)
 void OpenThermGWClimate::process_Slave_MSG_TOUTSIDE(uint32_t &response) {
     float outside_air_temperature = getFloat(response);
-    ESP_LOGD(TAG, "outside_air_temperature: %f", outside_air_temperature);
+    if (getMessageType(response) == OpenThermMessageType::READ_ACK)
+      this->outside_temperature_ = outside_air_temperature;
     if (this->outside_air_temperature != nullptr) {
-      this->outside_air_temperature->publish_state(outside_air_temperature);
+      publishSensor(this->outside_air_temperature, outside_air_temperature);
     }
 }
 
 // #28: Return water temperature to boiler (°C)
 void OpenThermGWClimate::process_Slave_MSG_TRET(uint32_t &response) {
     float return_water_temperature = getFloat(response);
-    ESP_LOGD(TAG, "return_water_temperature: %f", return_water_temperature);
+    if (this->return_water_temperature_stats_ != nullptr && getMessageType(response) == OpenThermMessageType::READ_ACK)
+      this->return_water_temperature_stats_->add(return_water_temperature);
     if (this->return_water_temperature != nullptr) {
-      this->return_water_temperature->publish_state(return_water_temperature);
+      publishSensor(this->return_water_temperature, return_water_temperature);
     }
 }
 
 // #29: Solar storage temperature (°C)
 void OpenThermGWClimate::process_Slave_MSG_TSTORAGE(uint32_t &response) {
     float solar_storage_temperature = getFloat(response);
-    ESP_LOGD(TAG, "solar_storage_temperature: %f", solar_storage_temperature);
     if (this->solar_storage_temperature != nullptr) {
-      this->solar_storage_temperature->publish_state(solar_storage_temperature);
+      publishSensor(this->solar_storage_temperature, solar_storage_temperature);
     }
 }
 
 // #30: Solar collector temperature (°C)
 void OpenThermGWClimate::process_Slave_MSG_TCOLLECTOR(uint32_t &response) {
     int16_t solar_collector_temperature = getInt16(response);
-    ESP_LOGD(TAG, "solar_collector_temperature: %d", solar_collector_temperature);
     if (this->solar_collector_temperature != nullptr) {
-      this->solar_collector_temperature->publish_state(solar_collector_temperature);
+      publishSensor(this->solar_collector_temperature, solar_collector_temperature);
     }
 }
 
 // #31: Flow water temperature of the second central
 void OpenThermGWClimate::process_Slave_MSG_TFLOWCH2(uint32_t &response) {
     float flow_temperature_ch2 = getFloat(response);
-    ESP_LOGD(TAG, "flow_temperature_ch2: %f", flow_temperature_ch2);
     if (this->flow_temperature_ch2 != nullptr) {
-      this->flow_temperature_ch2->publish_state(flow_temperature_ch2);
+      publishSensor(this->flow_temperature_ch2, flow_temperature_ch2);
     }
 }
 
 // #32: Domestic hot water temperature 2 (°C)
 void OpenThermGWClimate::process_Slave_MSG_TDHW2(uint32_t &response) {
     float dhw2_temperature = getFloat(response);
-    ESP_LOGD(TAG, "dhw2_temperature: %f", dhw2_temperature);
     if (this->dhw2_temperature != nullptr) {
-      this->dhw2_temperature->publish_state(dhw2_temperature);
+      publishSensor(this->dhw2_temperature, dhw2_temperature);
     }
 }
 
 // #33: Exhaust temperature (°C)
 void OpenThermGWClimate::process_Slave_MSG_TEXHAUST(uint32_t &response) {
     int16_t exhaust_temperature = getInt16(response);
-    ESP_LOGD(TAG, "exhaust_temperature: %d", exhaust_temperature);
     if (this->exhaust_temperature != nullptr) {
-      this->exhaust_temperature->publish_state(exhaust_temperature);
+      publishSensor(this->exhaust_temperature, exhaust_temperature);
     }
 }
 
 // #116: Number of starts burner. Reset by writing zero is optional for slave.
 void OpenThermGWClimate::process_Slave_MSG_BURNER_STARTS(uint32_t &response) {
     uint16_t burner_starts = getUInt16(response);
-    ESP_LOGD(TAG, "burner_starts: %d", burner_starts);
     if (this->burner_starts != nullptr) {
-      this->burner_starts->publish_state(burner_starts);
+      publishSensor(this->burner_starts, burner_starts);
     }
 }
 
 // #117: Number of starts CH pump. Reset by writing zero is optional for slave.
 void OpenThermGWClimate::process_Slave_MSG_CH_PUMP_STARTS(uint32_t &response) {
     uint16_t ch_pump_starts = getUInt16(response);
-    ESP_LOGD(TAG, "ch_pump_starts: %d", ch_pump_starts);
     if (this->ch_pump_starts != nullptr) {
-      this->ch_pump_starts->publish_state(ch_pump_starts);
+      publishSensor(this->ch_pump_starts, ch_pump_starts);
     }
 }
 
 // #118: Number of starts DHW pump/valve. Reset by writing zero is optional for slave.
 void OpenThermGWClimate::process_Slave_MSG_DHW_PUMP_VALVE_STARTS(uint32_t &response) {
     uint16_t dhw_pump_valve_starts = getUInt16(response);
-    ESP_LOGD(TAG, "dhw_pump_valve_starts: %d", dhw_pump_valve_starts);
     if (this->dhw_pump_valve_starts != nullptr) {
-      this->dhw_pump_valve_starts->publish_state(dhw_pump_valve_starts);
+      publishSensor(this->dhw_pump_valve_starts, dhw_pump_valve_starts);
     }
 }
 
 // #119: Number of starts burner in DHW mode. Reset by writing zero is optional for slave.
 void OpenThermGWClimate::process_Slave_MSG_DHW_BURNER_STARTS(uint32_t &response) {
     uint16_t dhw_burner_starts = getUInt16(response);
-    ESP_LOGD(TAG, "dhw_burner_starts: %d", dhw_burner_starts);
     if (this->dhw_burner_starts != nullptr) {
-      this->dhw_burner_starts->publish_state(dhw_burner_starts);
+      publishSensor(this->dhw_burner_starts, dhw_burner_starts);
     }
 }
 
 // #120: Number of hours that burner is in operation (i.e. flame on). Reset by writing zero is optional for slave.
 void OpenThermGWClimate::process_Slave_MSG_BURNER_OPERATION_HOURS(uint32_t &response) {
     uint16_t burner_operation_hours = getUInt16(response);
-    ESP_LOGD(TAG, "burner_operation_hours: %d", burner_operation_hours);
     if (this->burner_operation_hours != nullptr) {
-      this->burner_operation_hours->publish_state(burner_operation_hours);
+      publishSensor(this->burner_operation_hours, burner_operation_hours);
     }
 }
 
 // #121: Number of hours that CH pump has been running. Reset by writing zero is optional for slave.
 void OpenThermGWClimate::process_Slave_MSG_CH_PUMP_OPERATION_HOURS(uint32_t &response) {
     uint16_t ch_pump_operation_hours = getUInt16(response);
-    ESP_LOGD(TAG, "ch_pump_operation_hours: %d", ch_pump_operation_hours);
     if (this->ch_pump_operation_hours != nullptr) {
-      this->ch_pump_operation_hours->publish_state(ch_pump_operation_hours);
+      publishSensor(this->ch_pump_operation_hours, ch_pump_operation_hours);
     }
 }
 
 // #122: Number of hours that DHW pump has been running or DHW valve has been opened. Reset by writing zero is optional for slave.
 void OpenThermGWClimate::process_Slave_MSG_DHW_PUMP_VALVE_OPERATION_HOURS(uint32_t &response) {
     uint16_t dhw_pump_valve_operation_hours = getUInt16(response);
-    ESP_LOGD(TAG, "dhw_pump_valve_operation_hours: %d", dhw_pump_valve_operation_hours);
     if (this->dhw_pump_valve_operation_hours != nullptr) {
-      this->dhw_pump_valve_operation_hours->publish_state(dhw_pump_valve_operation_hours);
+      publishSensor(this->dhw_pump_valve_operation_hours, dhw_pump_valve_operation_hours);
     }
 }
 
 // #123: Number of hours that burner is in operation during DHW mode. Reset by writing zero is optional for slave.
 void OpenThermGWClimate::process_Slave_MSG_DHW_BURNER_OPERATION_HOURS(uint32_t &response) {
     uint16_t dhw_burner_operation_hours = getUInt16(response);
-    ESP_LOGD(TAG, "dhw_burner_operation_hours: %d", dhw_burner_operation_hours);
     if (this->dhw_burner_operation_hours != nullptr) {
-      this->dhw_burner_operation_hours->publish_state(dhw_burner_operation_hours);
+      publishSensor(this->dhw_burner_operation_hours, dhw_burner_operation_hours);
     }
 }
 
@@ -743,54 +1733,30 @@ void OpenThermGWClimate::process_Slave_MSG_DHW_BURNER_OPERATION_HOURS(uint32_t &
 
 // #6: Remote-parameter
 void OpenThermGWClimate::process_Slave_MSG_RBP_FLAGS(uint32_t &response) {
-    uint8_t ub = getUBUInt8(response);
-    uint8_t lb = getLBUInt8(response);
-
-    bool dhw_setpoint_enabled = ub & (1 << 0); // DHW setpoint
-    bool max_ch_setpoint_enabled = ub & (1 << 1); // max CHsetpoint
-
-    bool dhw_setpoint_readonly = lb & (1 << 0); // DHW setpoint read-only?
-    bool max_ch_setpoint_readonly = lb & (1 << 1); // max CHsetpoint read-only?
-
-    ESP_LOGD(TAG, "slave dhw enabled: %d, max_ch_setpoint_enabled: %d", dhw_setpoint_enabled, max_ch_setpoint_enabled);
 }
 
 // #48: DHW setpoint upper & lower bounds for adjustment (°C)
 void OpenThermGWClimate::process_Slave_MSG_TDHWSET_UB_LB(uint32_t &response) {
-    int8_t dhw_setpoint_ub = getUBInt8(response); // Upper bound for adjustment of DHW setpoint (°C)
-    int8_t dhw_setpoint_lb = getLBInt8(response); // Lower bound for adjustment of DHW setpoint (°C)
-    ESP_LOGD(TAG, "dhw_setpoint_ub: %d, dhw_setpoint_lb: %d", dhw_setpoint_ub, dhw_setpoint_lb);
 }
 
 // #49: Max CH water setpoint upper & lower bounds for adjustment (°C)
 void OpenThermGWClimate::process_Slave_MSG_MAXTSET_UB_LB(uint32_t &response) {
-    int8_t max_ch_setpoint_ub = getUBInt8(response); // Upper bound for adjustment of maxCHsetp (°C)
-    int8_t max_ch_setpoint_lb = getLBInt8(response); // Lower bound for adjustment of maxCHsetp (°C)
-    ESP_LOGD(TAG, "max_ch_setpoint_ub: %d, max_ch_setpoint_lb: %d", max_ch_setpoint_ub, max_ch_setpoint_lb);
 }
 
 // #56: DHW setpoint (°C) (Remote parameter 1)
 void OpenThermGWClimate::process_Master_MSG_TDHWSET(uint32_t &request) {
-    float dhw_setpoint = getFloat(request); // Domestic hot water temperature setpoint (°C)
-    ESP_LOGD(TAG, "master dhw_setpoint: %f", dhw_setpoint);
 }
 
 // #56: DHW setpoint (°C) (Remote parameter 1)
 void OpenThermGWClimate::process_Slave_MSG_TDHWSET(uint32_t &request) {
-    float dhw_setpoint = getFloat(request); // Domestic hot water temperature setpoint (°C)
-    ESP_LOGD(TAG, "slave dhw_setpoint: %f", dhw_setpoint);
 }
 
 // #57: Current room setpoint for 2nd CH circuit (°C)
 void OpenThermGWClimate::process_Master_MSG_MAXTSET(uint32_t &request) {
-    float max_ch_water_setpoint = getFloat(request); //  Maximum allowable CH water setpoint (°C)
-    ESP_LOGD(TAG, "master max_ch_water_setpoint: %f", max_ch_water_setpoint);
 }
 
 // #57: Current room setpoint for 2nd CH circuit (°C)
 void OpenThermGWClimate::process_Slave_MSG_MAXTSET(uint32_t &request) {
-    float max_ch_water_setpoint = getFloat(request); //  Maximum allowable CH water setpoint (°C)
-    ESP_LOGD(TAG, "slave max_ch_water_setpoint: %f", max_ch_water_setpoint);
 }
 
 /* Class 6 : Transparent Slave Parameters */
@@ -805,21 +1771,22 @@ void OpenThermGWClimate::process_Slave_MSG_MAXTSET(uint32_t &request) {
 // #10: Number of Transparent-Slave-Parameters supported by slave
 void OpenThermGWClimate::process_Slave_MSG_TSP(uint32_t &response) {
     uint8_t number_of_tsp = getUBUInt8(response); // Number of transparent-slave-parameter supported by the slave device.
-    ESP_LOGD(TAG, "number_of_tsp: %d", number_of_tsp);
+    if (getMessageType(response) == OpenThermMessageType::READ_ACK)
+      this->tsp_.set_size(number_of_tsp);
 }
 
 // #11: Index number / Value of referred-to transparent slave parameter.
 void OpenThermGWClimate::process_Master_MSG_TSP_INDEX_TSP_VALUE(uint32_t &response) {
-    uint8_t tsp_index_no = getUBUInt8(response); // Index number of following TSP
-    uint8_t tsp_value = getLBUInt8(response); // Value of above referenced TSP
-    ESP_LOGD(TAG, "tsp_index_no: %d, tsp_index_no: %d", tsp_index_no, tsp_index_no);
 }
 
 // #11: Index number / Value of referred-to transparent slave parameter.
 void OpenThermGWClimate::process_Slave_MSG_TSP_INDEX_TSP_VALUE(uint32_t &response) {
     uint8_t tsp_index_no = getUBUInt8(response); // Index number of following TSP
     uint8_t tsp_value = getLBUInt8(response); // Value of above referenced TSP
-    ESP_LOGD(TAG, "tsp_index_no: %d, tsp_index_no: %d", tsp_index_no, tsp_index_no);
+    if (getMessageType(response) == OpenThermMessageType::READ_ACK && this->tsp_.set(tsp_index_no, tsp_value)) {
+      this->parameters_changed_ = true;
+      this->parameter_callback_.call(false, tsp_index_no, tsp_value);
+    }
 }
 
 /* Class 7 : Fault History Data */
@@ -828,14 +1795,18 @@ void OpenThermGWClimate::process_Slave_MSG_TSP_INDEX_TSP_VALUE(uint32_t &respons
 // #12: Size of Fault-History-Buffer supported by slave
 void OpenThermGWClimate::process_Slave_MSG_FHB_SIZE(uint32_t &response) {
     uint8_t size_of_fault_buffer = getUBUInt8(response); // The size of the fault history buffer.
-    ESP_LOGD(TAG, "size_of_fault_buffer: %d", size_of_fault_buffer);
+    if (getMessageType(response) == OpenThermMessageType::READ_ACK)
+      this->fhb_.set_size(size_of_fault_buffer);
 }
 
 // #13: Index number / Value of referred-to fault-history buffer entry.
 void OpenThermGWClimate::process_Slave_MSG_FHB_INDEX_FHB_VALUE(uint32_t &response) {
     uint8_t fhb_entry_index_no = getUBUInt8(response); // Index number of following Fault Buffer entry
     uint8_t fhb_entry_value = getLBUInt8(response); // Value of above referenced Fault Buffer entry
-    ESP_LOGD(TAG, "fhb_entry_index_no: %d, fhb_entry_value: %d", fhb_entry_index_no, fhb_entry_value);
+    if (getMessageType(response) == OpenThermMessageType::READ_ACK && this->fhb_.set(fhb_entry_index_no, fhb_entry_value)) {
+      this->parameters_changed_ = true;
+      this->parameter_callback_.call(true, fhb_entry_index_no, fhb_entry_value);
+    }
 }
 
 
@@ -855,8 +1826,6 @@ void OpenThermGWClimate::process_Slave_MSG_FHB_INDEX_FHB_VALUE(uint32_t &respons
 // the cooling-enable flag (status) to control the cooling plant. The status of the cooling plant can be read from
 // the slave cooling status bit.
 void OpenThermGWClimate::process_Master_MSG_COOLING_CONTROL(uint32_t &request) {
-    float cooling_control_signal = getFloat(request); //  Cooling control signal (%)
-    ESP_LOGD(TAG, "cooling_control_signal: %f", cooling_control_signal);
 }
 
 // The boiler capacity level setting is to be used for boiler sequencer applications. The control setpoint should
@@ -867,19 +1836,10 @@ void OpenThermGWClimate::process_Master_MSG_COOLING_CONTROL(uint32_t &request) {
 // #14: Maximum relative modulation level setting
 void OpenThermGWClimate::process_Master_MSG_MAX_REL_MOD_LEVEL_SETTING(uint32_t &request) {
     // Maximum relative boiler modulation level setting for sequencer and off-low & pump control applications.
-    float max_rel_mod_level = getFloat(request);
-    if (this->max_relative_modulation_level.has_value()) {
-      max_rel_mod_level = this->max_relative_modulation_level.value();
-      request = modifyMsgData(request, max_rel_mod_level);
-    }
-    ESP_LOGD(TAG, "max_rel_mod_level: %f", max_rel_mod_level);
 }
 
 // #15: Maximum boiler capacity (kW) / Minimum boiler modulation level(%)
 void OpenThermGWClimate::process_Slave_MSG_MAX_CAPACITY_MIN_MOD_LEVEL(uint32_t &response) {
-    uint8_t max_boiler_capacity = getUBUInt8(response); // 0..255kW
-    uint8_t min_modulation_level = getLBUInt8(response); // 0..100% expressed as a percentage of the maximum capacity.
-    ESP_LOGD(TAG, "max_boiler_capacity: %d, min_modulation_level: %d", max_boiler_capacity, min_modulation_level);
 }
 
 // There are applications where it’s necessary to override the room setpoint of the master (room-unit).
@@ -893,16 +1853,10 @@ void OpenThermGWClimate::process_Slave_MSG_MAX_CAPACITY_MIN_MOD_LEVEL(uint32_t &
 
 // #9: Remote override room setpoint
 void OpenThermGWClimate::process_Slave_MSG_TROVERRIDE(uint32_t &response) {
-    float remote_override_room_setpoint = getFloat(response);
-    ESP_LOGD(TAG, "remote_override_room_setpoint: %f", remote_override_room_setpoint);
 }
 
 // #100:  Remote override function
 void OpenThermGWClimate::process_Slave_MSG_REMOTE_OVERRIDE_FUNCTION(uint32_t &response) {
-    uint8_t remote_override_function = getLBUInt8(response);
-    ESP_LOGD(TAG, "remote_override_function: %d", remote_override_function);
 }
-
-
 }  // namespace opentherm
 }  // namespace esphome
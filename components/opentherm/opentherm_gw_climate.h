@@ -2,22 +2,66 @@
 
 #include "esphome/core/component.h"
 #include "esphome/core/automation.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
 #include "esphome/components/sensor/sensor.h"
 #include "esphome/components/binary_sensor/binary_sensor.h"
+#include "esphome/components/text_sensor/text_sensor.h"
 #include "esphome/components/climate/climate.h"
 #include "esphome/components/climate/climate_mode.h"
 #include "esphome/components/climate/climate_traits.h"
 #include "opentherm.h"
+#include "opentherm_aggregator.h"
+#include "opentherm_controller.h"
+#include "opentherm_debug_log.h"
+#include "opentherm_energy.h"
+#include "opentherm_frame_log.h"
+#include "opentherm_line_server.h"
+#include "opentherm_metrics.h"
+#include "opentherm_mqtt_batch.h"
+#include "opentherm_parameters.h"
+#include "opentherm_poller.h"
+#include "opentherm_request_pool.h"
+#include "opentherm_snapshot.h"
+#include "opentherm_state.h"
+#include "opentherm_task.h"
+#include "opentherm_write_queue.h"
+
+#ifdef USE_OPENTHERM_LIGHT_SLEEP
+#include <esp_pm.h>
+#endif
 
 namespace esphome {
 namespace opentherm {
 
+enum OpenThermTransactionSource : uint8_t {
+  // Thermostat request relayed to the boiler.
+  SOURCE_RELAYED,
+  // Gateway-originated requests.
+  SOURCE_WRITE_QUEUE,
+  SOURCE_REQUEST_POOL,
+  SOURCE_FAILOVER,
+};
+
+// A request together with the boiler response it was answered with.
+struct OpenThermTransaction {
+  uint32_t request;
+  uint32_t response;
+  OpenThermResponseStatus status;
+  OpenThermTransactionSource source{SOURCE_RELAYED};
+  bool confirmed{false};
+  uint32_t forwarded{0};  // request as sent to the boiler, if the gateway changed it
+  uint32_t time{0};       // millis() when the thermostat's request was received
+  bool cached{false};     // response taken from the state table, the boiler was sent another request
+};
+
 class OpenThermGWClimate : public climate::Climate, public Component {
  public:
   OpenThermGWClimate();
   void setup() override;
   void dump_config() override;
   void loop() override;
+  void on_shutdown() override;
 
  protected:
   /// Override control to change settings of the climate device.
@@ -25,8 +69,56 @@ class OpenThermGWClimate : public climate::Climate, public Component {
   /// Return the traits of this controller.
   climate::ClimateTraits traits() override;
 
-  void processRequest(uint32_t request, OpenThermResponseStatus status);
-  void processResponse(uint32_t &response, OpenThermResponseStatus status);
+  // Relay path: runs in the protocol task when enabled, otherwise in loop().
+  void relay(uint32_t request, OpenThermResponseStatus status);
+  void overrideRequest(uint32_t &request);
+  void injectRequest();
+  bool injectFailover();
+  bool nextInjectedRequest(OpenThermTransaction &transaction, uint8_t &pool_index);
+  bool substituteRequest(const OpenThermTransaction &relayed);
+  void sendInjected(OpenThermTransaction &transaction, uint8_t pool_index);
+  void downloadParameters();
+  void pollAdaptive();
+  void thermostatSeen();
+  void runFailover();
+  float failoverSetpoint();
+  void failoverAnswered(const OpenThermTransaction &transaction);
+  void updateController();
+  void publishEnergy();
+#ifdef USE_OPENTHERM_ISR_STATS
+  void publishIsrStats();
+#endif
+#ifdef USE_OPENTHERM_BUS_PROFILE
+  void publishBusProfile();
+  void dumpBusProfile();
+#endif
+#ifdef USE_OPENTHERM_LIGHT_SLEEP
+  void setupLightSleep();
+  void updateSleepLock();
+  static esp_err_t lightSleepEnter(int64_t sleep_time_us, void *arg);
+  static esp_err_t lightSleepExit(int64_t sleep_time_us, void *arg);
+  void publishSleepStats();
+#endif
+#ifdef USE_OPENTHERM_LINE_SERVER
+  void reportTransaction(const OpenThermTransaction &transaction);
+  std::string handleLineCommand(const std::string &line);
+#endif
+  // Passive mode: pair requests and responses seen on the bus.
+  void sniffRequest(uint32_t request, OpenThermResponseStatus status);
+  void sniffResponse(uint32_t response, OpenThermResponseStatus status);
+  void pushTransaction(const OpenThermTransaction &transaction);
+  void updateSnapshot(const OpenThermTransaction &transaction);
+
+  void publishSensor(sensor::Sensor *sensor, float value);
+  void markPublishPending();
+  uint32_t maxPublishDelay();
+  void flushPublishes();
+  static void protocolTask(void *arg);
+  uint32_t timeUntilDeadline();
+
+  // Decode path: always runs in the main loop.
+  void processRequest(uint32_t request);
+  void processResponse(uint32_t response);
 
   void process_Master_MSG_COMMAND(uint32_t &request);
   void process_Master_MSG_DATE(uint32_t &request);
@@ -93,8 +185,131 @@ class OpenThermGWClimate : public climate::Climate, public Component {
   OpenThermChannel mOT;
   OpenThermChannel sOT;
 
+  HighFrequencyLoopRequester high_freq_;
+  bool use_protocol_task_{false};
+  bool passive_{false};
+  bool sniffed_request_pending_{false};
+  OpenThermTransaction sniffed_;
+  uint32_t sniffed_request_time_{0};
+  OpenThermTask task_;
+  OpenThermQueue<OpenThermTransaction, 16> transactions_;
+  std::atomic<uint32_t> dropped_transactions_{0};
+  std::atomic<uint32_t> unmatched_responses_{0};
+  OpenThermWriteQueue writes_;
+  // Room setpoint sent instead of the thermostat's, set from control().
+  std::atomic<uint16_t> room_setpoint_override_{0};  // 0: relay the thermostat's setpoint
+  // Data words substituted by overrideRequest(), -1: relay the thermostat's value.
+  std::atomic<int32_t> max_modulation_override_{-1};
+  std::atomic<int32_t> dhw_setpoint_override_{-1};
+  std::atomic<int32_t> max_ch_setpoint_override_{-1};
+  OpenThermRequestPool requests_;
+  uint8_t inject_turn_{0};
+  // Set after a relayed transaction: the bus is ours until the thermostat's next request.
+  bool injection_slot_{false};
+  uint32_t injection_slot_time_{0};
+  // Shortest recent gap between thermostat requests, 0 until one was seen.
+  uint32_t thermostat_request_time_{0};
+  uint32_t thermostat_interval_{0};
+  OpenThermFrameLog *frame_log_{nullptr};
+  OpenThermSnapshot snapshot_;
+
+  // Failover to master mode when the thermostat goes silent. The main loop
+  // keeps the status and control setpoint frames up to date; the protocol
+  // side sends them itself, ahead of the master slots.
+  static const uint32_t MASTER_SLOT_INTERVAL_MS = 500;
+  // Boilers fall back when the status exchange is more than a second apart.
+  static const uint32_t FAILOVER_STATUS_INTERVAL_MS = 800;
+  std::atomic<bool> master_mode_{false};
+  std::atomic<uint32_t> failover_status_{0};
+  std::atomic<uint32_t> failover_tset_{0};
+  uint32_t failover_status_time_{0};
+  bool failover_tset_due_{false};
+  uint32_t failover_timeout_{0};
+  float failover_setpoint_{45};
+  uint32_t thermostat_seen_time_{0};
+  uint8_t thermostat_status_{1 << 1};
+  float thermostat_tset_{0};
+  bool failover_active_{false};
+  bool failover_measured_{false};
+
+  OpenThermStateTable state_;
+#if ESPHOME_LOG_LEVEL >= ESPHOME_LOG_LEVEL_DEBUG
+  OpenThermDebugLog debug_log_;
+#endif
+  OpenThermEnergy energy_;
+  OpenThermAggregator *boiler_water_temp_stats_{nullptr};
+  OpenThermAggregator *return_water_temperature_stats_{nullptr};
+  OpenThermAggregator *relative_modulation_level_stats_{nullptr};
+  uint32_t energy_interval_{0};
+#ifdef USE_OPENTHERM_METRICS
+  OpenThermMetrics *metrics_{nullptr};
+  OpenThermCounters counters_;
+#endif
+#ifdef USE_OPENTHERM_MQTT_BATCH
+  OpenThermMqttBatch *mqtt_batch_{nullptr};
+  bool entity_updates_{true};
+#endif
+#ifdef USE_OPENTHERM_BUS_PROFILE
+  OpenThermPollingProfile polling_profile_;
+  // Busy time per channel (thermostat, boiler) at the last publish.
+  uint64_t bus_busy_seen_us_[2]{};
+  uint32_t bus_profile_time_{0};
+#endif
+#ifdef USE_OPENTHERM_LIGHT_SLEEP
+  // Automatic light sleep between frames. The lock keeps the CPU awake from
+  // sleep_margin_ ms before the next request is due until the bus is quiet.
+  uint32_t sleep_margin_{0};
+  esp_pm_lock_handle_t sleep_lock_{nullptr};
+  bool sleep_locked_{false};
+  // Written by the light sleep callbacks in the idle task.
+  uint32_t sleep_start_{0};
+  std::atomic<uint32_t> asleep_us_{0};
+  std::atomic<uint32_t> missed_start_bits_{0};
+  uint32_t sleep_stats_time_{0};
+#endif
+#ifdef USE_OPENTHERM_LINE_SERVER
+  OpenThermLineServer *line_server_{nullptr};
+#endif
+
+  OpenThermController controller_;
+  uint32_t controller_interval_{0};
+  std::atomic<uint16_t> controller_tset_{0};  // 0: relay the thermostat's setpoint
+  float outside_temperature_{NAN};
+
+  OpenThermPoller poller_;
+  bool adaptive_polling_{false};
+  bool poll_busy_{false};
+
+  OpenThermParameterTable tsp_;
+  OpenThermParameterTable fhb_;
+  CallbackManager<void(bool, uint8_t, uint8_t)> parameter_callback_;
+  bool parameters_changed_{false};
+  uint32_t parameter_interval_{0};
+  uint32_t parameter_refresh_interval_{0};
+  bool download_busy_{false};
+  bool download_done_{false};
+  bool download_fhb_{false};
+  int16_t download_index_{-1};
+  uint32_t download_done_time_{0};
+
+  struct PendingPublish {
+    sensor::Sensor *sensor;
+    float value;
+  };
+  static const uint8_t MAX_PENDING_PUBLISHES = 32;
+  PendingPublish pending_[MAX_PENDING_PUBLISHES];
+  uint8_t pending_count_{0};
+  bool climate_dirty_{false};
+  bool publish_pending_{false};
+  uint32_t publish_since_{0};
+  uint32_t publish_interval_{0};
+  uint32_t snapshot_interval_{0};
+
 public:
 
+  // The overrides below are the main loop's view; change them through their
+  // setters, which also hand the value to the protocol path.
+
   // If a maximum relative modulation level value has been configured, the gateway
   // will send the configured setpoint instead of the one received from the thermostat.
   optional<float> max_relative_modulation_level;
@@ -111,6 +326,64 @@ public:
   void set_thermostat_out_pin(InternalGPIOPin *thermostat_out_pin) { mOT.set_pin_out(thermostat_out_pin); }
   void set_boiler_in_pin(InternalGPIOPin *boiler_in_pin) { sOT.set_pin_in(boiler_in_pin); }
   void set_boiler_out_pin(InternalGPIOPin *boiler_out_pin) { sOT.set_pin_out(boiler_out_pin); }
+  void set_protocol_task(bool use_protocol_task) { this->use_protocol_task_ = use_protocol_task; }
+  // Send a request to the boiler without blocking. The callback runs in the main loop
+  // with the response, or with TIMEOUT if it could not be sent within timeout_ms.
+  // Requests share the bus fairly with relayed thermostat traffic: at most one is
+  // sent after each relayed transaction. Returns false when the pool is full.
+  bool submit(uint32_t request, OpenThermRequestCallback &&callback, uint32_t timeout_ms = 5000);
+  // Write a remote boiler parameter and keep sending it instead of the thermostat's value.
+  void set_dhw_setpoint(float dhw_setpoint);
+  void set_max_ch_water_setpoint(float max_ch_water_setpoint);
+  void set_max_relative_modulation_level(float max_relative_modulation_level);
+  void set_passive(bool passive) { this->passive_ = passive; }
+  void set_frame_log(OpenThermFrameLog *frame_log) { this->frame_log_ = frame_log; }
+  OpenThermFrameLog *get_frame_log() { return this->frame_log_; }
+  void set_warm_start(uint32_t save_interval) { this->snapshot_interval_ = save_interval; }
+  void set_publish_interval(uint32_t publish_interval) { this->publish_interval_ = publish_interval; }
+  void set_parameter_download(uint32_t interval, uint32_t refresh_interval) {
+    this->parameter_interval_ = interval;
+    this->parameter_refresh_interval_ = refresh_interval;
+  }
+  void set_boiler_water_temp_stats(OpenThermAggregator *stats) { this->boiler_water_temp_stats_ = stats; }
+  void set_return_water_temperature_stats(OpenThermAggregator *stats) { this->return_water_temperature_stats_ = stats; }
+  void set_relative_modulation_level_stats(OpenThermAggregator *stats) { this->relative_modulation_level_stats_ = stats; }
+  void set_energy_interval(uint32_t energy_interval) { this->energy_interval_ = energy_interval; }
+  void set_controller(uint32_t interval) { this->controller_interval_ = interval; }
+#ifdef USE_OPENTHERM_METRICS
+  void set_metrics(OpenThermMetrics *metrics) { this->metrics_ = metrics; }
+#endif
+#ifdef USE_OPENTHERM_MQTT_BATCH
+  // Without entity updates the sensors keep their last state for every
+  // consumer, not just MQTT; only the batch carries new values.
+  void set_mqtt_batch(OpenThermMqttBatch *mqtt_batch, bool entity_updates) {
+    this->mqtt_batch_ = mqtt_batch;
+    this->entity_updates_ = entity_updates;
+  }
+#endif
+#ifdef USE_OPENTHERM_LIGHT_SLEEP
+  void set_light_sleep(uint32_t wake_margin) { this->sleep_margin_ = wake_margin; }
+#endif
+#ifdef USE_OPENTHERM_LINE_SERVER
+  void set_line_server(OpenThermLineServer *line_server) { this->line_server_ = line_server; }
+#endif
+  // Latest boiler response per data-ID, safe to read from any task.
+  const OpenThermStateTable &get_state() const { return this->state_; }
+  OpenThermController *get_controller() { return &this->controller_; }
+  void set_failover(uint32_t timeout, float setpoint) {
+    this->failover_timeout_ = timeout;
+    this->failover_setpoint_ = setpoint;
+  }
+  void set_adaptive_polling(uint32_t active_interval, uint32_t idle_interval) {
+    this->adaptive_polling_ = true;
+    this->poller_.set_intervals(active_interval, idle_interval);
+  }
+  // Called with (fault history buffer?, index, value) whenever a cached TSP or FHB entry changes.
+  void add_on_parameter_change_callback(std::function<void(bool, uint8_t, uint8_t)> &&callback) {
+    this->parameter_callback_.add(std::move(callback));
+  }
+  const OpenThermParameterTable &get_tsp() const { return this->tsp_; }
+  const OpenThermParameterTable &get_fhb() const { return this->fhb_; }
 
   binary_sensor::BinarySensor *is_ch2_active{nullptr};
   binary_sensor::BinarySensor *is_ch_active{nullptr};
@@ -119,6 +392,8 @@ public:
   binary_sensor::BinarySensor *is_diagnostic_event{nullptr};
   binary_sensor::BinarySensor *is_fault_indication{nullptr};
   binary_sensor::BinarySensor *is_flame_on{nullptr};
+  binary_sensor::BinarySensor *is_restored_stale{nullptr};
+  binary_sensor::BinarySensor *is_failover_active{nullptr};
   sensor::Sensor *boiler_water_temp{nullptr};
   sensor::Sensor *burner_operation_hours{nullptr};
   sensor::Sensor *burner_starts{nullptr};
@@ -139,6 +414,21 @@ public:
   sensor::Sensor *return_water_temperature{nullptr};
   sensor::Sensor *solar_collector_temperature{nullptr};
   sensor::Sensor *solar_storage_temperature{nullptr};
+  sensor::Sensor *failover_latency{nullptr};
+  sensor::Sensor *controller_setpoint{nullptr};
+  sensor::Sensor *burner_hours{nullptr};
+  sensor::Sensor *isr_max_duration{nullptr};
+  sensor::Sensor *isr_max_edge_error{nullptr};
+  sensor::Sensor *ch_hours{nullptr};
+  sensor::Sensor *dhw_hours{nullptr};
+  sensor::Sensor *full_load_hours{nullptr};
+  sensor::Sensor *burner_duty_cycle{nullptr};
+  sensor::Sensor *awake_ratio{nullptr};
+  sensor::Sensor *thermostat_bus_load{nullptr};
+  sensor::Sensor *boiler_bus_load{nullptr};
+  text_sensor::TextSensor *tsp_values{nullptr};
+  text_sensor::TextSensor *fhb_values{nullptr};
+  text_sensor::TextSensor *polling_profile{nullptr};
 
   void set_is_ch2_active(binary_sensor::BinarySensor *ch2_active) {this->is_ch2_active =ch2_active; };
   void set_is_ch_active(binary_sensor::BinarySensor *ch_active) {this->is_ch_active =ch_active; };
@@ -147,6 +437,8 @@ public:
   void set_is_diagnostic_event(binary_sensor::BinarySensor *diagnostic_event) {this->is_diagnostic_event =diagnostic_event; };
   void set_is_fault_indication(binary_sensor::BinarySensor *fault_indication) {this->is_fault_indication =fault_indication; };
   void set_is_flame_on(binary_sensor::BinarySensor *flame_on) {this->is_flame_on =flame_on; };
+  void set_is_restored_stale(binary_sensor::BinarySensor *restored_stale) {this->is_restored_stale =restored_stale; };
+  void set_is_failover_active(binary_sensor::BinarySensor *failover_active) {this->is_failover_active =failover_active; };
   void set_boiler_water_temp(sensor::Sensor *boiler_water_temp) {this->boiler_water_temp = boiler_water_temp;};
   void set_burner_operation_hours(sensor::Sensor *burner_operation_hours) {this->burner_operation_hours = burner_operation_hours;};
   void set_burner_starts(sensor::Sensor *burner_starts) {this->burner_starts = burner_starts;};
@@ -167,6 +459,35 @@ public:
   void set_return_water_temperature(sensor::Sensor *return_water_temperature) {this->return_water_temperature = return_water_temperature;};
   void set_solar_collector_temperature(sensor::Sensor *solar_collector_temperature) {this->solar_collector_temperature = solar_collector_temperature;};
   void set_solar_storage_temperature(sensor::Sensor *solar_storage_temperature) {this->solar_storage_temperature = solar_storage_temperature;};
+  void set_isr_max_duration(sensor::Sensor *isr_max_duration) {this->isr_max_duration = isr_max_duration;};
+  void set_isr_max_edge_error(sensor::Sensor *isr_max_edge_error) {this->isr_max_edge_error = isr_max_edge_error;};
+  void set_burner_hours(sensor::Sensor *burner_hours) {this->burner_hours = burner_hours;};
+  void set_ch_hours(sensor::Sensor *ch_hours) {this->ch_hours = ch_hours;};
+  void set_dhw_hours(sensor::Sensor *dhw_hours) {this->dhw_hours = dhw_hours;};
+  void set_full_load_hours(sensor::Sensor *full_load_hours) {this->full_load_hours = full_load_hours;};
+  void set_burner_duty_cycle(sensor::Sensor *burner_duty_cycle) {this->burner_duty_cycle = burner_duty_cycle;};
+  void set_awake_ratio(sensor::Sensor *awake_ratio) {this->awake_ratio = awake_ratio;};
+  void set_thermostat_bus_load(sensor::Sensor *thermostat_bus_load) {this->thermostat_bus_load = thermostat_bus_load;};
+  void set_boiler_bus_load(sensor::Sensor *boiler_bus_load) {this->boiler_bus_load = boiler_bus_load;};
+  void set_controller_setpoint(sensor::Sensor *controller_setpoint) {this->controller_setpoint = controller_setpoint;};
+  void set_failover_latency(sensor::Sensor *failover_latency) {this->failover_latency = failover_latency;};
+  void set_tsp_values(text_sensor::TextSensor *tsp_values) {this->tsp_values = tsp_values;};
+  void set_fhb_values(text_sensor::TextSensor *fhb_values) {this->fhb_values = fhb_values;};
+  void set_polling_profile(text_sensor::TextSensor *polling_profile) {this->polling_profile = polling_profile;};
+};
+
+// Write the stored frame log to the log, oldest record first.
+template<typename... Ts> class DumpFrameLogAction : public Action<Ts...> {
+ public:
+  DumpFrameLogAction(OpenThermGWClimate *parent) : parent_(parent) {}
+
+  void play(Ts... x) override {
+    if (this->parent_->get_frame_log() != nullptr)
+      this->parent_->get_frame_log()->dump();
+  }
+
+ protected:
+  OpenThermGWClimate *parent_;
 };
 
 }  // namespace opentherm
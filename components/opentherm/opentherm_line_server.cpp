@@ -0,0 +1,186 @@
+#include "opentherm_line_server.h"
+
+#ifdef USE_OPENTHERM_LINE_SERVER
+
+#include "esphome/core/log.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace esphome {
+namespace opentherm {
+
+static const char *TAG = "opentherm.line_server";
+
+bool OpenThermLineServer::begin()
+{
+  this->socket_ = socket::socket_ip(SOCK_STREAM, 0);
+  if (this->socket_ == nullptr) {
+    ESP_LOGE(TAG, "Could not create socket");
+    return false;
+  }
+  int enable = 1;
+  this->socket_->setsockopt(SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+  this->socket_->setblocking(false);
+
+  struct sockaddr_storage server;
+  socklen_t len = socket::set_sockaddr_any((struct sockaddr *) &server, sizeof(server), this->port_);
+  if (len == 0 || this->socket_->bind((struct sockaddr *) &server, len) != 0 || this->socket_->listen(MAX_CLIENTS) != 0) {
+    ESP_LOGE(TAG, "Could not listen on port %u: errno %d", this->port_, errno);
+    this->socket_ = nullptr;
+    return false;
+  }
+  return true;
+}
+
+void OpenThermLineServer::loop()
+{
+  if (this->socket_ == nullptr)
+    return;
+  this->accept();
+  for (Client &client : this->clients_) {
+    if (client.socket == nullptr)
+      continue;
+    this->read(client);
+    if (client.socket != nullptr)
+      this->flush(client);
+  }
+}
+
+void OpenThermLineServer::accept()
+{
+  while (true) {
+    struct sockaddr_storage source;
+    socklen_t len = sizeof(source);
+    auto socket = this->socket_->accept((struct sockaddr *) &source, &len);
+    if (socket == nullptr)
+      return;
+
+    Client *free = nullptr;
+    for (Client &client : this->clients_) {
+      if (client.socket == nullptr) {
+        free = &client;
+        break;
+      }
+    }
+    if (free == nullptr) {
+      ESP_LOGW(TAG, "Rejecting %s, all %u client slots in use", socket->getpeername().c_str(), MAX_CLIENTS);
+      socket->close();
+      continue;
+    }
+
+    ESP_LOGD(TAG, "Client %s connected", socket->getpeername().c_str());
+    socket->setblocking(false);
+    free->socket = std::move(socket);
+    free->head = 0;
+    free->len = 0;
+    free->line_len = 0;
+    free->line_overflow = false;
+  }
+}
+
+void OpenThermLineServer::read(Client &client)
+{
+  char buffer[64];
+  while (true) {
+    ssize_t received = client.socket->read(buffer, sizeof(buffer));
+    if (received == 0 || (received < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+      this->disconnect(client);
+      return;
+    }
+    if (received < 0)
+      return;
+
+    for (ssize_t i = 0; i < received; i++) {
+      char c = buffer[i];
+      if (c != '\r' && c != '\n') {
+        if (client.line_len < LINE_SIZE - 1)
+          client.line[client.line_len++] = c;
+        else
+          client.line_overflow = true;
+        continue;
+      }
+      if (client.line_len > 0 && !client.line_overflow && this->handler_) {
+        std::string reply = this->handler_(std::string(client.line, client.line_len));
+        reply += "\r\n";
+        this->enqueue(client, reply.data(), reply.size());
+      }
+      client.line_len = 0;
+      client.line_overflow = false;
+    }
+  }
+}
+
+void OpenThermLineServer::send_frame(char source, uint32_t frame)
+{
+  static const char HEX[] = "0123456789ABCDEF";
+  char line[11];
+  line[0] = source;
+  for (uint8_t i = 0; i < 8; i++)
+    line[1 + i] = HEX[(frame >> (28 - 4 * i)) & 0xF];
+  line[9] = '\r';
+  line[10] = '\n';
+  this->send_line(line, sizeof(line));
+}
+
+void OpenThermLineServer::send_line(const char *line, size_t len)
+{
+  for (Client &client : this->clients_) {
+    if (client.socket != nullptr)
+      this->enqueue(client, line, len);
+  }
+}
+
+// Lines are queued whole or not at all.
+void OpenThermLineServer::enqueue(Client &client, const char *data, size_t len)
+{
+  if (client.len + len > QUEUE_SIZE) {
+    this->lines_dropped_++;
+    return;
+  }
+  size_t tail = (client.head + client.len) % QUEUE_SIZE;
+  size_t first = std::min(len, QUEUE_SIZE - tail);
+  memcpy(client.queue + tail, data, first);
+  memcpy(client.queue, data + first, len - first);
+  client.len += len;
+}
+
+void OpenThermLineServer::flush(Client &client)
+{
+  while (client.len > 0) {
+    size_t chunk = std::min(client.len, QUEUE_SIZE - client.head);
+    ssize_t sent = client.socket->write(client.queue + client.head, chunk);
+    if (sent < 0) {
+      if (errno != EAGAIN && errno != EWOULDBLOCK)
+        this->disconnect(client);
+      return;
+    }
+    client.head = (client.head + sent) % QUEUE_SIZE;
+    client.len -= sent;
+    if ((size_t) sent < chunk)
+      return;
+  }
+}
+
+void OpenThermLineServer::disconnect(Client &client)
+{
+  ESP_LOGD(TAG, "Client %s disconnected", client.socket->getpeername().c_str());
+  client.socket->close();
+  client.socket = nullptr;
+  client.len = 0;
+}
+
+uint8_t OpenThermLineServer::client_count() const
+{
+  uint8_t count = 0;
+  for (const Client &client : this->clients_) {
+    if (client.socket != nullptr)
+      count++;
+  }
+  return count;
+}
+
+}  // namespace opentherm
+}  // namespace esphome
+
+#endif
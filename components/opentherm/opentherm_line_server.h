@@ -0,0 +1,79 @@
+#pragma once
+/*
+TCP server speaking the OpenTherm Gateway (OTGW) serial line protocol.
+
+Every frame is sent to all clients as one line: a source letter followed by
+the frame in hex, e.g. "T80000200" for a thermostat request.
+
+  T: request from the thermostat      B: response from the boiler
+  R: request sent by the gateway      A: answer sent by the gateway
+
+Lines received from clients are passed to the command handler, which returns
+the reply line. Each client has a bounded queue; lines that do not fit are
+dropped for that client only, so a slow client never holds up the others or
+the gateway.
+*/
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_OPENTHERM_LINE_SERVER
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <string>
+#include "esphome/components/socket/socket.h"
+
+namespace esphome {
+namespace opentherm {
+
+class OpenThermLineServer {
+ public:
+  static const uint8_t MAX_CLIENTS = 4;
+  static const size_t QUEUE_SIZE = 1024;
+  static const size_t LINE_SIZE = 32;
+
+  OpenThermLineServer(uint16_t port) : port_(port) {}
+
+  void set_command_handler(std::function<std::string(const std::string &)> &&handler) {
+    this->handler_ = std::move(handler);
+  }
+
+  bool begin();
+  void loop();
+  void send_frame(char source, uint32_t frame);
+  void send_line(const char *line, size_t len);
+
+  uint16_t port() const { return this->port_; }
+  uint8_t client_count() const;
+  uint32_t lines_dropped() const { return this->lines_dropped_; }
+
+ protected:
+  struct Client {
+    std::unique_ptr<socket::Socket> socket;
+    char queue[QUEUE_SIZE];
+    size_t head{0};  // first queued byte
+    size_t len{0};
+    char line[LINE_SIZE];
+    size_t line_len{0};
+    bool line_overflow{false};
+  };
+
+  void accept();
+  void read(Client &client);
+  void enqueue(Client &client, const char *data, size_t len);
+  void flush(Client &client);
+  void disconnect(Client &client);
+
+  uint16_t port_;
+  std::unique_ptr<socket::Socket> socket_;
+  std::function<std::string(const std::string &)> handler_;
+  Client clients_[MAX_CLIENTS];
+  uint32_t lines_dropped_{0};
+};
+
+}  // namespace opentherm
+}  // namespace esphome
+
+#endif
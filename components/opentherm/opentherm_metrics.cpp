@@ -0,0 +1,173 @@
+#include "opentherm_metrics.h"
+
+#ifdef USE_OPENTHERM_METRICS
+
+#include <cinttypes>
+#include <cstdarg>
+#include <cstdio>
+#include "opentherm.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace opentherm {
+
+static const char *TAG = "opentherm.metrics";
+
+static const char *CONTENT_TYPE = "text/plain; version=0.0.4; charset=utf-8";
+static const char *CHANNEL_NAMES[2] = {"thermostat", "boiler"};
+
+// Append to the buffer, stopping at its end. Returns false once full.
+static bool append(char *buffer, size_t size, size_t &len, const char *format, ...)
+    __attribute__((format(printf, 4, 5)));
+static bool append(char *buffer, size_t size, size_t &len, const char *format, ...)
+{
+  if (len >= size - 1)
+    return false;
+  va_list args;
+  va_start(args, format);
+  int n = vsnprintf(buffer + len, size - len, format, args);
+  va_end(args);
+  if (n < 0 || len + n >= size) {
+    len = size - 1;
+    return false;
+  }
+  len += n;
+  return true;
+}
+
+bool OpenThermMetrics::begin()
+{
+  RAMAllocator<char> allocator;
+  this->buffers_ = allocator.allocate(2 * BUFFER_SIZE);
+  if (this->buffers_ == nullptr) {
+    ESP_LOGE(TAG, "Could not allocate the metrics buffers");
+    return false;
+  }
+  this->base_->init();
+  this->base_->add_handler(this);
+  return true;
+}
+
+bool OpenThermMetrics::canHandle(AsyncWebServerRequest *request)
+{
+  return request->method() == HTTP_GET && request->url() == this->path_;
+}
+
+void OpenThermMetrics::handleRequest(AsyncWebServerRequest *request)
+{
+  this->current_ ^= 1;
+  char *buffer = this->buffers_ + this->current_ * BUFFER_SIZE;
+  size_t len = this->render(buffer, BUFFER_SIZE);
+  request->send(request->beginResponse_P(200, CONTENT_TYPE, (const uint8_t *) buffer, len));
+}
+
+size_t OpenThermMetrics::render(char *buffer, size_t size)
+{
+  size_t len = 0;
+  append(buffer, size, len, "# TYPE opentherm_transactions_total counter\n");
+  for (uint8_t status = SUCCESS; status <= INVMSGTYPE; status++)
+    append(buffer, size, len, "opentherm_transactions_total{status=\"%s\"} %" PRIu32 "\n",
+           statusToString((OpenThermResponseStatus) status),
+           this->counters_->status[status].load(std::memory_order_relaxed));
+  append(buffer, size, len, "# TYPE opentherm_dropped_transactions_total counter\n"
+                            "opentherm_dropped_transactions_total %" PRIu32 "\n",
+         this->counters_->dropped.load(std::memory_order_relaxed));
+  append(buffer, size, len, "# TYPE opentherm_responses_total counter\nopentherm_responses_total %" PRIu32 "\n",
+         this->state_->updates());
+
+  // Each family is one block: its TYPE line followed by both channels.
+  if (this->profiles_[0] != nullptr || this->profiles_[1] != nullptr) {
+    append(buffer, size, len, "# TYPE opentherm_bus_frames_total counter\n");
+    for (uint8_t i = 0; i < 2; i++) {
+      if (this->profiles_[i] != nullptr)
+        append(buffer, size, len, "opentherm_bus_frames_total{channel=\"%s\"} %" PRIu32 "\n", CHANNEL_NAMES[i],
+               this->profiles_[i]->frames());
+    }
+    append(buffer, size, len, "# TYPE opentherm_bus_busy_seconds_total counter\n");
+    for (uint8_t i = 0; i < 2; i++) {
+      if (this->profiles_[i] != nullptr)
+        append(buffer, size, len, "opentherm_bus_busy_seconds_total{channel=\"%s\"} %.6f\n", CHANNEL_NAMES[i],
+               this->profiles_[i]->busy_us() / 1e6);
+    }
+    append(buffer, size, len, "# TYPE opentherm_bus_idle_gaps_total counter\n");
+    for (uint8_t i = 0; i < 2; i++) {
+      const OpenThermBusProfile *profile = this->profiles_[i];
+      if (profile == nullptr)
+        continue;
+      for (uint8_t bucket = 0; bucket < OpenThermBusProfile::GAP_BUCKETS; bucket++) {
+        if (bucket < OpenThermBusProfile::GAP_BUCKETS - 1)
+          append(buffer, size, len,
+                 "opentherm_bus_idle_gaps_total{channel=\"%s\",below_ms=\"%" PRIu32 "\"} %" PRIu32 "\n",
+                 CHANNEL_NAMES[i], OpenThermBusProfile::GAP_BASE_MS << bucket, profile->gaps(bucket));
+        else
+          append(buffer, size, len, "opentherm_bus_idle_gaps_total{channel=\"%s\",below_ms=\"+Inf\"} %" PRIu32 "\n",
+                 CHANNEL_NAMES[i], profile->gaps(bucket));
+      }
+    }
+  }
+
+  // Boiler values: numbers as they are, byte pairs as two series.
+  this->state_->get_all(this->values_, this->timestamps_, this->statuses_);
+  append(buffer, size, len, "# TYPE opentherm_value gauge\n");
+  bool ok = true;
+  for (uint16_t id = 0; id < 256 && ok; id++) {
+    uint8_t type = this->statuses_[id];
+    if (type != READ_ACK && type != WRITE_ACK)
+      continue;
+    OpenThermFrame frame = OpenThermFrame::response((OpenThermMessageType) type, (OpenThermMessageID) id, this->values_[id]);
+    const OpenThermMessageInfo *info = getMessageInfo(id);
+    const char *name = info != nullptr ? info->name : "";
+    switch (info != nullptr ? info->type : U16) {
+      case F88:
+        ok = append(buffer, size, len, "opentherm_value{id=\"%u\",name=\"%s\"} %.2f\n", id, name, frame.f88());
+        break;
+      case S16:
+        ok = append(buffer, size, len, "opentherm_value{id=\"%u\",name=\"%s\"} %d\n", id, name, frame.s16());
+        break;
+      case S8_S8:
+        ok = append(buffer, size, len,
+                    "opentherm_value{id=\"%u\",name=\"%s\",byte=\"high\"} %d\n"
+                    "opentherm_value{id=\"%u\",name=\"%s\",byte=\"low\"} %d\n",
+                    id, name, frame.hb_s8(), id, name, frame.lb_s8());
+        break;
+      case FLAG8_FLAG8:
+      case FLAG8_U8:
+      case U8_U8:
+        ok = append(buffer, size, len,
+                    "opentherm_value{id=\"%u\",name=\"%s\",byte=\"high\"} %u\n"
+                    "opentherm_value{id=\"%u\",name=\"%s\",byte=\"low\"} %u\n",
+                    id, name, frame.hb(), id, name, frame.lb());
+        break;
+      case U16:
+      default:
+        ok = append(buffer, size, len, "opentherm_value{id=\"%u\",name=\"%s\"} %u\n", id, name, frame.value());
+        break;
+    }
+  }
+
+  uint32_t now = millis();
+  append(buffer, size, len, "# TYPE opentherm_value_age_seconds gauge\n");
+  for (uint16_t id = 0; id < 256 && ok; id++) {
+    uint8_t type = this->statuses_[id];
+    if (type != READ_ACK && type != WRITE_ACK)
+      continue;
+    const OpenThermMessageInfo *info = getMessageInfo(id);
+    ok = append(buffer, size, len, "opentherm_value_age_seconds{id=\"%u\",name=\"%s\"} %.1f\n", id,
+                info != nullptr ? info->name : "", (now - this->timestamps_[id]) / 1000.0f);
+  }
+
+  // A truncated document still has to end with a complete line.
+  if (len == size - 1) {
+    while (len > 0 && buffer[len - 1] != '\n')
+      len--;
+    ESP_LOGW(TAG, "Metrics truncated to %zu bytes", len);
+  }
+  return len;
+}
+
+}  // namespace opentherm
+}  // namespace esphome
+
+#endif
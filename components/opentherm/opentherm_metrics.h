@@ -0,0 +1,75 @@
+#pragma once
+/*
+Prometheus metrics for the gateway, served at /metrics on web_server_base.
+
+A scrape renders the latest boiler values from the state table, the protocol
+counters and, if enabled, the bus profile into a preallocated buffer in one
+pass. Everything it reads is either atomic or copied through the state
+table's seqlock, so it never takes a lock the relay path could wait on, no
+matter which task the web server runs in or how often it is scraped.
+
+Two buffers are used in turn, since the response may still be sending from
+the previous one when the next scrape comes in.
+*/
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_OPENTHERM_METRICS
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "esphome/components/web_server_base/web_server_base.h"
+#include "opentherm_profiler.h"
+#include "opentherm_state.h"
+
+namespace esphome {
+namespace opentherm {
+
+// Protocol counters kept by the relay path for the metrics handler.
+struct OpenThermCounters {
+  // Transactions by OpenThermResponseStatus.
+  std::atomic<uint32_t> status[6]{};
+  std::atomic<uint32_t> dropped{0};
+};
+
+class OpenThermMetrics : public AsyncWebHandler {
+ public:
+  static const size_t BUFFER_SIZE = 6144;
+
+  OpenThermMetrics(web_server_base::WebServerBase *base, const char *path) : base_(base), path_(path) {}
+
+  void set_sources(const OpenThermStateTable *state, const OpenThermCounters *counters) {
+    this->state_ = state;
+    this->counters_ = counters;
+  }
+  void set_bus_profiles(const OpenThermBusProfile *thermostat, const OpenThermBusProfile *boiler) {
+    this->profiles_[0] = thermostat;
+    this->profiles_[1] = boiler;
+  }
+  bool begin();
+  const char *path() const { return this->path_; }
+
+  bool canHandle(AsyncWebServerRequest *request) override;
+  void handleRequest(AsyncWebServerRequest *request) override;
+  bool isRequestHandlerTrivial() override { return false; }
+
+ protected:
+  size_t render(char *buffer, size_t size);
+
+  web_server_base::WebServerBase *base_;
+  const char *path_;
+  const OpenThermStateTable *state_{nullptr};
+  const OpenThermCounters *counters_{nullptr};
+  const OpenThermBusProfile *profiles_[2]{};
+  char *buffers_{nullptr};
+  uint8_t current_{0};
+  uint16_t values_[256];
+  uint32_t timestamps_[256];
+  uint8_t statuses_[256];
+};
+
+}  // namespace opentherm
+}  // namespace esphome
+
+#endif
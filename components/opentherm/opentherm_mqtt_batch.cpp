@@ -0,0 +1,74 @@
+#include "opentherm_mqtt_batch.h"
+
+#ifdef USE_OPENTHERM_MQTT_BATCH
+
+#include <cinttypes>
+#include <cstdio>
+#include "opentherm_frame.h"
+#include "esphome/components/mqtt/mqtt_client.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace opentherm {
+
+static const char *TAG = "opentherm.mqtt_batch";
+
+void OpenThermMqttBatch::begin()
+{
+  if (this->topic_.empty())
+    this->topic_ = mqtt::global_mqtt_client->get_topic_prefix() + "/opentherm";
+}
+
+void OpenThermMqttBatch::publish(const OpenThermStateTable &state, uint32_t now)
+{
+  if (!mqtt::global_mqtt_client->is_connected())
+    return;
+
+  state.get_all(this->values_, this->timestamps_, this->statuses_);
+  size_t len = snprintf(this->buffer_, BUFFER_SIZE, "{\"uptime\":%" PRIu32, now);
+  uint8_t count = 0;
+  for (uint16_t id = 0; id < 256; id++) {
+    uint8_t type = this->statuses_[id];
+    if (type != READ_ACK && type != WRITE_ACK)
+      continue;
+    // Only what arrived since the last publish; the first one sends everything.
+    if (this->started_ && (int32_t)(this->timestamps_[id] - this->last_) < 0)
+      continue;
+
+    OpenThermFrame frame = OpenThermFrame::response((OpenThermMessageType) type, (OpenThermMessageID) id, this->values_[id]);
+    const OpenThermMessageInfo *info = getMessageInfo(id);
+    char value[24];
+    formatValue(value, sizeof(value), frame.raw());
+    bool number = info == nullptr || info->type == F88 || info->type == S16 || info->type == U16;
+    char key[8];
+    if (info == nullptr)
+      snprintf(key, sizeof(key), "ID%u", id);
+    int n = snprintf(this->buffer_ + len, BUFFER_SIZE - len, number ? ",\"%s\":%s" : ",\"%s\":\"%s\"",
+                     info != nullptr ? info->name : key, value);
+    // Keep room for the closing brace.
+    if (n < 0 || len + n + 1 >= BUFFER_SIZE) {
+      this->buffer_[len] = '\0';
+      this->skipped_++;
+      continue;
+    }
+    len += n;
+    count++;
+  }
+  this->last_ = now;
+  this->started_ = true;
+  if (count == 0)
+    return;
+
+  this->buffer_[len++] = '}';
+  this->buffer_[len] = '\0';
+  mqtt::global_mqtt_client->publish(this->topic_, this->buffer_, len, this->qos_, this->retain_);
+  if (this->skipped_ > 0) {
+    ESP_LOGW(TAG, "%" PRIu32 " values did not fit in the batch", this->skipped_);
+    this->skipped_ = 0;
+  }
+}
+
+}  // namespace opentherm
+}  // namespace esphome
+
+#endif
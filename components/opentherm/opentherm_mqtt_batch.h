@@ -0,0 +1,57 @@
+#pragma once
+/*
+All values received during a bus cycle, published as one MQTT message.
+
+Every sensor publishes its own topic when MQTT is used, so a bus cycle turns
+into dozens of small packets. On every publish flush (once per bus cycle, or
+per publish interval) this collects the boiler responses received since the
+previous flush from the state table into one JSON object keyed by message
+name, e.g.
+
+  {"uptime":123456,"STATUS":"0x03/0x0A","TBOILER":45.50,"TRET":38.25}
+
+Numeric values are written as numbers, flags and byte pairs as strings. The
+payload is built in a fixed buffer; entries that do not fit are left out.
+*/
+
+#include "esphome/core/defines.h"
+
+#ifdef USE_OPENTHERM_MQTT_BATCH
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include "opentherm_state.h"
+
+namespace esphome {
+namespace opentherm {
+
+class OpenThermMqttBatch {
+ public:
+  static const size_t BUFFER_SIZE = 1024;
+
+  // An empty topic publishes to "<topic prefix>/opentherm".
+  OpenThermMqttBatch(const std::string &topic, uint8_t qos, bool retain) : topic_(topic), qos_(qos), retain_(retain) {}
+
+  void begin();
+  // Publish the responses received since the previous call, if any.
+  void publish(const OpenThermStateTable &state, uint32_t now);
+  const std::string &topic() const { return this->topic_; }
+
+ protected:
+  std::string topic_;
+  uint8_t qos_;
+  bool retain_;
+  uint32_t last_{0};
+  bool started_{false};
+  uint32_t skipped_{0};
+  char buffer_[BUFFER_SIZE];
+  uint16_t values_[256];
+  uint32_t timestamps_[256];
+  uint8_t statuses_[256];
+};
+
+}  // namespace opentherm
+}  // namespace esphome
+
+#endif
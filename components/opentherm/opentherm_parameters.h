@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+namespace esphome {
+namespace opentherm {
+
+// Cached transparent slave parameters (TSP) or fault history buffer (FHB) entries.
+class OpenThermParameterTable {
+ public:
+  void set_size(uint8_t size) {
+    this->size_ = size;
+    this->size_known_ = true;
+  }
+  bool size_known() const { return this->size_known_; }
+  uint8_t size() const { return this->size_; }
+
+  // Returns true when the entry was not known yet or its value changed.
+  bool set(uint8_t index, uint8_t value) {
+    bool changed = !this->has(index) || this->values_[index] != value;
+    this->values_[index] = value;
+    this->valid_[index / 32] |= 1ul << (index % 32);
+    return changed;
+  }
+  bool has(uint8_t index) const { return this->valid_[index / 32] & (1ul << (index % 32)); }
+  uint8_t get(uint8_t index) const { return this->values_[index]; }
+
+  // Two hex digits per entry for up to count entries from first on, "--" for
+  // entries not read yet.
+  std::string to_hex(uint16_t first = 0, uint16_t count = 256) const {
+    static const char *DIGITS = "0123456789ABCDEF";
+    if (first >= this->size_)
+      return "";
+    count = std::min<uint16_t>(count, this->size_ - first);
+    std::string out(count * 2, '-');
+    for (uint16_t i = 0; i < count; i++) {
+      if (this->has(first + i)) {
+        out[i * 2] = DIGITS[this->values_[first + i] >> 4];
+        out[i * 2 + 1] = DIGITS[this->values_[first + i] & 0xF];
+      }
+    }
+    return out;
+  }
+
+  // to_hex() of the whole table in at most max_length characters. If it does
+  // not fit, the leading entries that do are followed by " +N" for the N
+  // entries left out.
+  std::string to_hex_limited(size_t max_length) const {
+    if (this->size_ * 2u <= max_length)
+      return this->to_hex();
+    uint16_t count = this->size_;
+    std::string suffix;
+    while (count > 0 && count * 2u + suffix.size() > max_length) {
+      count--;
+      suffix = " +" + std::to_string(this->size_ - count);
+    }
+    return this->to_hex(0, count) + suffix;
+  }
+
+ protected:
+  uint8_t size_{0};
+  bool size_known_{false};
+  uint8_t values_[256];
+  uint32_t valid_[8]{};
+};
+
+}  // namespace opentherm
+}  // namespace esphome
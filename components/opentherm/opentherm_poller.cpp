@@ -0,0 +1,40 @@
+#include "opentherm_poller.h"
+
+namespace esphome {
+namespace opentherm {
+
+bool OpenThermPoller::add(uint8_t id, uint8_t active_flags)
+{
+  if (this->count_ == CAPACITY)
+    return false;
+  // Start due at the first idle interval, the thermostat may well read it by then.
+  this->entries_[this->count_++] = Entry{id, active_flags, 0};
+  return true;
+}
+
+void OpenThermPoller::seen(uint8_t id, uint32_t now)
+{
+  for (uint8_t i = 0; i < this->count_; i++) {
+    if (this->entries_[i].id == id)
+      this->entries_[i].last_seen = now;
+  }
+}
+
+bool OpenThermPoller::next(uint32_t now, uint8_t &id)
+{
+  bool found = false;
+  uint32_t most_overdue = 0;
+  for (uint8_t i = 0; i < this->count_; i++) {
+    uint32_t age = now - this->entries_[i].last_seen;
+    uint32_t interval = this->interval(i);
+    if (age >= interval && (!found || age - interval > most_overdue)) {
+      found = true;
+      most_overdue = age - interval;
+      id = this->entries_[i].id;
+    }
+  }
+  return found;
+}
+
+}  // namespace opentherm
+}  // namespace esphome
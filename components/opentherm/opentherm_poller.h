@@ -0,0 +1,58 @@
+#pragma once
+/*
+State-adaptive polling of data-IDs the thermostat reads too rarely.
+
+Every entry names the boiler status flags during which it changes quickly.
+While one of those flags is set the entry is polled at the active interval,
+otherwise at the idle interval. Any response for the data-ID, relayed from the
+thermostat or polled by the gateway, resets its timer, so polls are only sent
+when the thermostat is not already reading the value often enough.
+*/
+
+#include <cstdint>
+
+namespace esphome {
+namespace opentherm {
+
+// Boiler status flags from the low byte of MSG_STATUS.
+static const uint8_t STATUS_CH_ACTIVE = 1 << 1;
+static const uint8_t STATUS_DHW_ACTIVE = 1 << 2;
+static const uint8_t STATUS_FLAME_ON = 1 << 3;
+
+class OpenThermPoller {
+ public:
+  static const uint8_t CAPACITY = 8;
+
+  bool add(uint8_t id, uint8_t active_flags);
+  void set_intervals(uint32_t active_interval, uint32_t idle_interval) {
+    this->active_interval_ = active_interval;
+    this->idle_interval_ = idle_interval;
+  }
+
+  // Latest boiler status flags.
+  void set_status(uint8_t flags) { this->status_ = flags; }
+  // A response for the data-ID was seen on the bus.
+  void seen(uint8_t id, uint32_t now);
+  // Data-ID most overdue for a poll, if any.
+  bool next(uint32_t now, uint8_t &id);
+
+  uint32_t interval(uint8_t index) const {
+    return (this->entries_[index].active_flags & this->status_) ? this->active_interval_ : this->idle_interval_;
+  }
+
+ protected:
+  struct Entry {
+    uint8_t id;
+    uint8_t active_flags;
+    uint32_t last_seen;
+  };
+
+  Entry entries_[CAPACITY];
+  uint8_t count_{0};
+  uint8_t status_{0};
+  uint32_t active_interval_{2000};
+  uint32_t idle_interval_{60000};
+};
+
+}  // namespace opentherm
+}  // namespace esphome
@@ -0,0 +1,72 @@
+#include "opentherm_profiler.h"
+
+namespace esphome {
+namespace opentherm {
+
+void OpenThermBusProfile::frame(uint32_t start_us, uint32_t end_us)
+{
+  uint32_t frames = this->frames_.load(std::memory_order_relaxed);
+  if (frames > 0 && (int32_t)(start_us - this->last_end_us_) >= 0) {
+    uint32_t gap_ms = (start_us - this->last_end_us_) / 1000;
+    uint8_t bucket = 0;
+    while (bucket < GAP_BUCKETS - 1 && gap_ms >= (GAP_BASE_MS << bucket))
+      bucket++;
+    this->gaps_[bucket].fetch_add(1, std::memory_order_relaxed);
+  }
+  this->last_end_us_ = end_us;
+  uint32_t low = this->busy_low_.load(std::memory_order_relaxed);
+  uint32_t busy = low + (end_us - start_us);
+  if (busy >= low) {
+    this->busy_low_.store(busy, std::memory_order_relaxed);
+  } else {
+    uint32_t sequence = this->busy_sequence_.load(std::memory_order_relaxed);
+    this->busy_sequence_.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    this->busy_high_.store(this->busy_high_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    this->busy_low_.store(busy, std::memory_order_relaxed);
+    this->busy_sequence_.store(sequence + 2, std::memory_order_release);
+  }
+  this->frames_.store(frames + 1, std::memory_order_relaxed);
+}
+
+uint64_t OpenThermBusProfile::busy_us() const
+{
+  for (;;) {
+    uint32_t sequence = this->busy_sequence_.load(std::memory_order_acquire);
+    uint32_t high = this->busy_high_.load(std::memory_order_relaxed);
+    uint32_t low = this->busy_low_.load(std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if ((sequence & 1) == 0 && this->busy_sequence_.load(std::memory_order_relaxed) == sequence)
+      return ((uint64_t) high << 32) | low;
+  }
+}
+
+void OpenThermPollingProfile::record(uint8_t id, uint32_t now)
+{
+  uint8_t i = 0;
+  while (i < this->count_ && this->entries_[i].id != id)
+    i++;
+  if (i == this->count_) {
+    if (i == CAPACITY) {
+      this->overflow_++;
+      return;
+    }
+    this->entries_[i] = Entry{id, 0, now, UINT32_MAX, 0, 0};
+    this->count_++;
+  }
+
+  Entry &entry = this->entries_[i];
+  if (entry.count > 0) {
+    uint32_t interval = now - entry.last_ms;
+    if (interval < entry.min_interval_ms)
+      entry.min_interval_ms = interval;
+    if (interval > entry.max_interval_ms)
+      entry.max_interval_ms = interval;
+    entry.total_interval_ms += interval;
+  }
+  entry.last_ms = now;
+  entry.count++;
+}
+
+}  // namespace opentherm
+}  // namespace esphome
@@ -0,0 +1,77 @@
+#pragma once
+/*
+Bus occupancy and polling pattern of the thermostat.
+
+OpenThermBusProfile counts, per channel, the frames on the wire, the time they
+occupy the bus and the distribution of the idle gaps between them. It is
+written by whichever task runs the channel and read by the main loop and the
+metrics handler; all counters only grow, so readers work with differences
+between two reads and nothing is ever reset across tasks. The busy time is
+kept in 64 bits as two words; the writer brackets the rare carry into the
+high word with a sequence number, so readers never see a torn value.
+
+OpenThermPollingProfile keeps the request interval of every data-ID the
+thermostat reads or writes in a fixed-size table, filled in the main loop.
+*/
+
+#include <atomic>
+#include <cstdint>
+
+namespace esphome {
+namespace opentherm {
+
+class OpenThermBusProfile {
+ public:
+  static const uint8_t GAP_BUCKETS = 8;
+  // Bucket i counts gaps below GAP_BASE_MS << i, the last one everything above.
+  static const uint32_t GAP_BASE_MS = 25;
+
+  // A frame occupied the bus from start_us to end_us.
+  void frame(uint32_t start_us, uint32_t end_us);
+
+  uint32_t frames() const { return this->frames_.load(std::memory_order_relaxed); }
+  // Bus time since boot.
+  uint64_t busy_us() const;
+  uint32_t gaps(uint8_t bucket) const { return this->gaps_[bucket].load(std::memory_order_relaxed); }
+
+ protected:
+  std::atomic<uint32_t> frames_{0};
+  std::atomic<uint32_t> busy_low_{0};
+  std::atomic<uint32_t> busy_high_{0};
+  std::atomic<uint32_t> busy_sequence_{0};  // odd while busy_high_ is being carried into
+  std::atomic<uint32_t> gaps_[GAP_BUCKETS]{};
+  uint32_t last_end_us_{0};
+};
+
+class OpenThermPollingProfile {
+ public:
+  static const uint8_t CAPACITY = 32;
+
+  struct Entry {
+    uint8_t id;
+    uint32_t count;
+    uint32_t last_ms;
+    uint32_t min_interval_ms;
+    uint32_t max_interval_ms;
+    uint64_t total_interval_ms;
+
+    // Mean interval between requests in milliseconds, 0 until seen twice.
+    uint32_t mean_interval_ms() const { return this->count > 1 ? (uint32_t)(this->total_interval_ms / (this->count - 1)) : 0; }
+  };
+
+  // The thermostat sent a request for the data-ID at now (ms).
+  void record(uint8_t id, uint32_t now);
+
+  uint8_t size() const { return this->count_; }
+  const Entry &entry(uint8_t index) const { return this->entries_[index]; }
+  // Requests for data-IDs that no longer fit in the table.
+  uint32_t overflow() const { return this->overflow_; }
+
+ protected:
+  Entry entries_[CAPACITY];
+  uint8_t count_{0};
+  uint32_t overflow_{0};
+};
+
+}  // namespace opentherm
+}  // namespace esphome
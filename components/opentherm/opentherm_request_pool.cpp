@@ -0,0 +1,80 @@
+#include "opentherm_request_pool.h"
+#include "esphome/core/hal.h"
+
+namespace esphome {
+namespace opentherm {
+
+bool OpenThermRequestPool::submit(uint32_t request, OpenThermRequestCallback &&callback, uint32_t timeout_ms)
+{
+  for (Slot &slot : this->slots_) {
+    if (slot.state.load(std::memory_order_acquire) != FREE)
+      continue;
+    slot.request = request;
+    slot.callback = std::move(callback);
+    slot.deadline = millis() + timeout_ms;
+    slot.state.store(QUEUED, std::memory_order_release);
+    return true;
+  }
+  return false;
+}
+
+void OpenThermRequestPool::poll()
+{
+  uint32_t now = millis();
+  for (Slot &slot : this->slots_) {
+    uint8_t state = slot.state.load(std::memory_order_acquire);
+    if (state == QUEUED && (int32_t)(now - slot.deadline) >= 0) {
+      // Only expire the request if the protocol path has not picked it up meanwhile.
+      if (!slot.state.compare_exchange_strong(state, DONE))
+        continue;
+      slot.response = 0;
+      slot.status = OpenThermResponseStatus::TIMEOUT;
+    } else if (state != DONE) {
+      continue;
+    }
+
+    OpenThermRequestCallback callback = std::move(slot.callback);
+    slot.callback = nullptr;
+    uint32_t response = slot.response;
+    OpenThermResponseStatus status = slot.status;
+    slot.state.store(FREE, std::memory_order_release);
+    if (callback)
+      callback(response, status);
+  }
+}
+
+uint8_t OpenThermRequestPool::in_use() const
+{
+  uint8_t count = 0;
+  for (const Slot &slot : this->slots_) {
+    if (slot.state.load(std::memory_order_relaxed) != FREE)
+      count++;
+  }
+  return count;
+}
+
+bool OpenThermRequestPool::next(uint8_t &index, uint32_t &request)
+{
+  for (uint8_t n = 0; n < CAPACITY; n++) {
+    uint8_t i = (this->next_ + n) % CAPACITY;
+    uint8_t expected = QUEUED;
+    if (this->slots_[i].state.compare_exchange_strong(expected, IN_FLIGHT)) {
+      index = i;
+      request = this->slots_[i].request;
+      this->next_ = (i + 1) % CAPACITY;
+      return true;
+    }
+  }
+  return false;
+}
+
+void OpenThermRequestPool::complete(uint8_t index, uint32_t response, OpenThermResponseStatus status)
+{
+  Slot &slot = this->slots_[index];
+  slot.response = response;
+  slot.status = status;
+  slot.state.store(DONE, std::memory_order_release);
+}
+
+}  // namespace opentherm
+}  // namespace esphome
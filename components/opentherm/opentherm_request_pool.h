@@ -0,0 +1,51 @@
+#pragma once
+/*
+Preallocated pool of asynchronous requests other components can send to the boiler.
+
+Slots are claimed and released by the main loop; the protocol path only moves
+a queued slot to in-flight and then to done. Completion callbacks always run in
+the main loop, so they may publish entities or submit the next request.
+*/
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include "opentherm.h"
+
+namespace esphome {
+namespace opentherm {
+
+using OpenThermRequestCallback = std::function<void(uint32_t response, OpenThermResponseStatus status)>;
+
+class OpenThermRequestPool {
+ public:
+  static const uint8_t CAPACITY = 8;
+
+  // Main loop: returns false if all slots are in use.
+  bool submit(uint32_t request, OpenThermRequestCallback &&callback, uint32_t timeout_ms);
+  // Main loop: run callbacks of completed and expired requests.
+  void poll();
+  uint8_t in_use() const;
+
+  // Protocol path: take the next queued request, round-robin over slots.
+  bool next(uint8_t &index, uint32_t &request);
+  void complete(uint8_t index, uint32_t response, OpenThermResponseStatus status);
+
+ protected:
+  enum State : uint8_t { FREE, QUEUED, IN_FLIGHT, DONE };
+
+  struct Slot {
+    std::atomic<uint8_t> state{FREE};
+    uint32_t request;
+    uint32_t response;
+    OpenThermResponseStatus status;
+    uint32_t deadline;
+    OpenThermRequestCallback callback;
+  };
+
+  Slot slots_[CAPACITY];
+  uint8_t next_{0};
+};
+
+}  // namespace opentherm
+}  // namespace esphome
@@ -0,0 +1,190 @@
+#include "opentherm_rmt.h"
+#include "opentherm.h"
+#include "esphome/core/hal.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace opentherm {
+
+static const uint32_t HALF_BIT_US = 500;
+// A level held between these is one half bit, up to MAX_RUN_US two half bits.
+static const uint32_t MIN_HALF_US = 250;
+static const uint32_t SPLIT_US = 750;
+static const uint32_t MAX_RUN_US = 1250;
+
+void IRAM_ATTR OpenThermManchesterDecoder::reset()
+{
+  this->bits_ = 0;
+  this->count_ = 0;
+  this->halves_ = 0;
+  this->error_ = false;
+}
+
+void IRAM_ATTR OpenThermManchesterDecoder::feed(bool level, uint32_t duration_us)
+{
+  if (duration_us == 0 || this->error_)
+    return;
+  if (duration_us < MIN_HALF_US || duration_us > MAX_RUN_US || (this->halves_ == 0 && !level)) {
+    this->error_ = true;
+    return;
+  }
+  for (uint8_t n = duration_us < SPLIT_US ? 1 : 2; n > 0; n--) {
+    if (this->halves_++ % 2 == 0) {
+      this->first_ = level;
+    }
+    else if (level == this->first_ || this->count_ == 34) {
+      // No transition in the middle of the bit, or too many bits.
+      this->error_ = true;
+      return;
+    }
+    else {
+      this->bits_ = (this->bits_ << 1) | this->first_;
+      this->count_++;
+    }
+  }
+}
+
+bool IRAM_ATTR OpenThermManchesterDecoder::finish(uint32_t &frame)
+{
+  if (!this->error_ && this->halves_ % 2 == 1 && this->first_ && this->count_ < 34) {
+    this->bits_ = (this->bits_ << 1) | 1;
+    this->count_++;
+  }
+  // Start and stop bits are both ones.
+  if (this->error_ || this->count_ != 34 || !(this->bits_ & (1ULL << 33)) || !(this->bits_ & 1))
+    return false;
+  frame = (uint32_t)(this->bits_ >> 1);
+  return true;
+}
+
+#ifdef USE_OPENTHERM_RMT
+static const char *TAG = "opentherm.rmt";
+
+static const uint32_t RESOLUTION_HZ = 1000000;
+// Pulses shorter than this are filtered out by the peripheral.
+static const uint32_t GLITCH_NS = 2000;
+// The input staying at one level this long ends the frame.
+static const uint32_t IDLE_NS = 1500000;
+static const int TRANSMIT_TIMEOUT_MS = 100;
+
+bool OpenThermRmt::setup(InternalGPIOPin *pin_in, InternalGPIOPin *pin_out, OpenThermStore *store)
+{
+  this->store_ = store;
+
+  rmt_rx_channel_config_t rx_config{};
+  rx_config.gpio_num = (gpio_num_t) pin_in->get_pin();
+  rx_config.clk_src = RMT_CLK_SRC_DEFAULT;
+  rx_config.resolution_hz = RESOLUTION_HZ;
+  rx_config.mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL;
+  rx_config.flags.invert_in = pin_in->is_inverted();
+  rmt_rx_event_callbacks_t callbacks{};
+  callbacks.on_recv_done = OpenThermRmt::on_receive;
+  if (rmt_new_rx_channel(&rx_config, &this->rx_) != ESP_OK ||
+      rmt_rx_register_event_callbacks(this->rx_, &callbacks, this) != ESP_OK || rmt_enable(this->rx_) != ESP_OK) {
+    ESP_LOGE(TAG, "Failed to set up RMT receive channel on GPIO%u", pin_in->get_pin());
+    this->rx_ = nullptr;
+    return false;
+  }
+
+  if (pin_out != nullptr) {
+    rmt_tx_channel_config_t tx_config{};
+    tx_config.gpio_num = (gpio_num_t) pin_out->get_pin();
+    tx_config.clk_src = RMT_CLK_SRC_DEFAULT;
+    tx_config.resolution_hz = RESOLUTION_HZ;
+    tx_config.mem_block_symbols = SOC_RMT_MEM_WORDS_PER_CHANNEL;
+    tx_config.trans_queue_depth = 1;
+    // The bus is idle with the output high, which is what the channel drives
+    // between transmissions: RMT level 1 is the active (low) output.
+    tx_config.flags.invert_out = !pin_out->is_inverted();
+    rmt_copy_encoder_config_t encoder_config{};
+    if (rmt_new_tx_channel(&tx_config, &this->tx_) != ESP_OK ||
+        rmt_new_copy_encoder(&encoder_config, &this->encoder_) != ESP_OK || rmt_enable(this->tx_) != ESP_OK) {
+      ESP_LOGE(TAG, "Failed to set up RMT transmit channel on GPIO%u", pin_out->get_pin());
+      this->tx_ = nullptr;
+      return false;
+    }
+  }
+
+  this->receive();
+  return true;
+}
+
+void OpenThermRmt::receive()
+{
+  if (this->rx_ == nullptr)
+    return;
+  rmt_receive_config_t config{};
+  config.signal_range_min_ns = GLITCH_NS;
+  config.signal_range_max_ns = IDLE_NS;
+  // Set before arming, a frame can only complete after this returns.
+  this->armed_ = true;
+  if (rmt_receive(this->rx_, this->rx_symbols_, sizeof(this->rx_symbols_), &config) != ESP_OK)
+    this->armed_ = false;
+}
+
+bool OpenThermRmt::transmit(uint32_t frame)
+{
+  if (this->tx_ == nullptr)
+    return false;
+
+  // Our own waveform may be echoed on the input, don't capture it.
+  rmt_disable(this->rx_);
+  this->armed_ = false;
+
+  uint64_t bits = (1ULL << 33) | ((uint64_t) frame << 1) | 1;
+  for (uint8_t i = 0; i < 34; i++) {
+    bool one = (bits >> (33 - i)) & 1;
+    // A one is sent as active followed by idle, a zero the other way round.
+    this->tx_symbols_[i].level0 = one;
+    this->tx_symbols_[i].duration0 = HALF_BIT_US;
+    this->tx_symbols_[i].level1 = !one;
+    this->tx_symbols_[i].duration1 = HALF_BIT_US;
+  }
+  rmt_transmit_config_t config{};
+  bool ok = rmt_transmit(this->tx_, this->encoder_, this->tx_symbols_, sizeof(this->tx_symbols_), &config) == ESP_OK &&
+            rmt_tx_wait_all_done(this->tx_, TRANSMIT_TIMEOUT_MS) == ESP_OK;
+
+  rmt_enable(this->rx_);
+  this->receive();
+  return ok;
+}
+
+// Runs in interrupt context once the input has been idle after a frame. The
+// receiver is re-armed from OpenThermChannel::loop().
+bool IRAM_ATTR OpenThermRmt::on_receive(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *event, void *arg)
+{
+  OpenThermRmt *rmt = static_cast<OpenThermRmt *>(arg);
+  OpenThermStore *store = rmt->store_;
+  rmt->armed_ = false;
+  store->pending = true;
+
+  // Same gating as the GPIO decoder: a channel that is not waiting for a
+  // response only listens when it faces the thermostat or is passive.
+  OpenThermStatus status = store->status;
+  if (status != OpenThermStatus::RESPONSE_WAITING &&
+      !(status == OpenThermStatus::READY && (!store->isSlave || store->passive)))
+    return false;
+
+  OpenThermManchesterDecoder decoder;
+  decoder.reset();
+  for (size_t i = 0; i < event->num_symbols; i++) {
+    decoder.feed(event->received_symbols[i].level0, event->received_symbols[i].duration0);
+    decoder.feed(event->received_symbols[i].level1, event->received_symbols[i].duration1);
+  }
+  uint32_t frame;
+  if (decoder.finish(frame)) {
+    store->response = frame;
+    store->status = OpenThermStatus::RESPONSE_READY;
+  }
+  else {
+    store->status = OpenThermStatus::RESPONSE_INVALID;
+  }
+  store->responseTimestamp = micros();
+  if (store->task != nullptr)
+    store->task->notify_from_isr();
+  return false;
+}
+#endif
+
+}  // namespace opentherm
+}  // namespace esphome
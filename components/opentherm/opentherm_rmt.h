@@ -0,0 +1,73 @@
+#pragma once
+/*
+RMT backend for an OpenTherm channel.
+
+By default a channel takes a GPIO interrupt on every edge and times the bits it
+sends with delayMicroseconds(). With the RMT backend (ESP32, ESP-IDF 5 RMT
+driver) the receive channel captures the level durations of a whole frame and
+the transmit channel plays back the Manchester waveform in hardware, so the CPU
+is involved once per frame instead of once per edge and bit timing no longer
+suffers from WiFi interrupts.
+
+Received durations are turned into a frame by OpenThermManchesterDecoder, which
+does not depend on the driver.
+*/
+
+#include <cstdint>
+#include "esphome/core/defines.h"
+#include "esphome/core/gpio.h"
+
+#ifdef USE_OPENTHERM_RMT
+#include <driver/rmt_rx.h>
+#include <driver/rmt_tx.h>
+#endif
+
+namespace esphome {
+namespace opentherm {
+
+// Decodes a frame from consecutive input levels and their durations, starting
+// with the rising edge of the start bit. A bit is the level of its first half.
+class OpenThermManchesterDecoder {
+ public:
+  void reset();
+  // Add a level held for duration_us. Zero durations (end markers) are ignored.
+  void feed(bool level, uint32_t duration_us);
+  // The low half of the stop bit merges with the idle line and may be missing.
+  bool finish(uint32_t &frame);
+
+ protected:
+  uint64_t bits_{0};
+  uint8_t count_{0};
+  uint8_t halves_{0};
+  bool first_{false};
+  bool error_{false};
+};
+
+struct OpenThermStore;
+
+#ifdef USE_OPENTHERM_RMT
+class OpenThermRmt {
+ public:
+  // The output pin is optional, a passive channel only receives.
+  bool setup(InternalGPIOPin *pin_in, InternalGPIOPin *pin_out, OpenThermStore *store);
+  bool is_armed() const { return this->armed_; }
+  // Start capturing the next frame.
+  void receive();
+  // Send a frame with start and stop bits, blocking until it is on the bus.
+  bool transmit(uint32_t frame);
+
+ protected:
+  static bool on_receive(rmt_channel_handle_t channel, const rmt_rx_done_event_data_t *event, void *arg);
+
+  OpenThermStore *store_{nullptr};
+  rmt_channel_handle_t rx_{nullptr};
+  rmt_channel_handle_t tx_{nullptr};
+  rmt_encoder_handle_t encoder_{nullptr};
+  rmt_symbol_word_t rx_symbols_[SOC_RMT_MEM_WORDS_PER_CHANNEL];
+  rmt_symbol_word_t tx_symbols_[34];
+  volatile bool armed_{false};
+};
+#endif
+
+}  // namespace opentherm
+}  // namespace esphome
@@ -0,0 +1,77 @@
+#include "opentherm_snapshot.h"
+#include "opentherm.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace opentherm {
+
+static const char *TAG = "opentherm.snapshot";
+
+void OpenThermSnapshot::begin(uint32_t hash)
+{
+  this->pref_ = global_preferences->make_preference<Table>(hash, true);
+  if (!this->pref_.load(&this->table_) || this->table_.count > CAPACITY)
+    this->table_.count = 0;
+
+  for (uint8_t i = 0; i < this->table_.count; i++)
+    this->stale_ |= 1ull << i;
+  this->stale_count_ = this->table_.count;
+}
+
+void OpenThermSnapshot::update(bool boiler, uint32_t frame)
+{
+  uint8_t id = getDataID(frame);
+  uint8_t flags = (boiler ? 1 : 0) | (getMessageType(frame) << 4);
+  uint16_t value = getUInt16(frame);
+
+  uint8_t i = 0;
+  while (i < this->table_.count &&
+         (this->table_.entries[i].id != id || (this->table_.entries[i].flags & 1) != (flags & 1)))
+    i++;
+
+  if (i == this->table_.count) {
+    if (i == CAPACITY)
+      return;
+    this->table_.entries[i] = Entry{id, flags, value};
+    this->table_.count++;
+    this->dirty_ = true;
+    return;
+  }
+
+  if (this->stale_ & (1ull << i)) {
+    this->stale_ &= ~(1ull << i);
+    this->stale_count_--;
+  }
+
+  Entry &entry = this->table_.entries[i];
+  if (entry.flags != flags || entry.value != value) {
+    entry.flags = flags;
+    entry.value = value;
+    this->dirty_ = true;
+  }
+}
+
+void OpenThermSnapshot::save()
+{
+  if (!this->dirty_)
+    return;
+  if (this->pref_.save(&this->table_)) {
+    this->dirty_ = false;
+    ESP_LOGD(TAG, "Saved %u values", this->table_.count);
+  }
+}
+
+uint8_t OpenThermSnapshot::replay(const std::function<void(bool, uint32_t)> &callback)
+{
+  for (uint8_t i = 0; i < this->table_.count; i++) {
+    const Entry &entry = this->table_.entries[i];
+    uint32_t frame = ((uint32_t)((entry.flags >> 4) & 7) << 28) | ((uint32_t) entry.id << 16) | entry.value;
+    if (parity(frame))
+      frame |= 1ul << 31;
+    callback(entry.flags & 1, frame);
+  }
+  return this->table_.count;
+}
+
+}  // namespace opentherm
+}  // namespace esphome
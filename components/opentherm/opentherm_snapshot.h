@@ -0,0 +1,53 @@
+#pragma once
+/*
+Warm-start snapshot of the last known decoded values.
+
+The last value seen for every data-ID is kept in a compact table that is saved
+to preferences at most once per save interval, and only when something changed.
+After a reboot the table is replayed through the normal decode path so entities
+have a value immediately; those values count as stale until the same data-ID has
+been seen on the bus again.
+*/
+
+#include <cstdint>
+#include <functional>
+#include "esphome/core/preferences.h"
+
+namespace esphome {
+namespace opentherm {
+
+class OpenThermSnapshot {
+ public:
+  static const uint8_t CAPACITY = 48;
+
+  void begin(uint32_t hash);
+  // Remember a frame that was just received on the bus.
+  void update(bool boiler, uint32_t frame);
+  // Persist the table if it changed since the last save.
+  void save();
+  // Call with every restored frame; returns the number of frames replayed.
+  uint8_t replay(const std::function<void(bool, uint32_t)> &callback);
+  uint8_t stale_count() const { return this->stale_count_; }
+
+ protected:
+  struct Entry {
+    uint8_t id;
+    uint8_t flags;  // bit 0: boiler response, bits 4-6: message type
+    uint16_t value;
+  } __attribute__((packed));
+
+  struct Table {
+    uint8_t count;
+    Entry entries[CAPACITY];
+  } __attribute__((packed));
+
+  ESPPreferenceObject pref_;
+  Table table_{};
+  bool dirty_{false};
+  // Restored entries not refreshed from the bus yet, one bit per slot.
+  uint64_t stale_{0};
+  uint8_t stale_count_{0};
+};
+
+}  // namespace opentherm
+}  // namespace esphome
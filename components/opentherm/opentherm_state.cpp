@@ -0,0 +1,59 @@
+#include "opentherm_state.h"
+#include "opentherm.h"
+#include <cstring>
+
+namespace esphome {
+namespace opentherm {
+
+OpenThermStateTable::OpenThermStateTable()
+{
+  memset(this->values_, 0, sizeof(this->values_));
+  memset(this->timestamps_, 0, sizeof(this->timestamps_));
+  memset(this->statuses_, NO_RESPONSE, sizeof(this->statuses_));
+}
+
+void OpenThermStateTable::update(uint32_t response, uint32_t now)
+{
+  uint8_t id = getDataID(response);
+  uint32_t sequence = this->sequence_.load(std::memory_order_relaxed);
+  this->sequence_.store(sequence + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  this->values_[id] = getUInt16(response);
+  this->timestamps_[id] = now;
+  this->statuses_[id] = getMessageType(response);
+  this->sequence_.store(sequence + 2, std::memory_order_release);
+}
+
+template<typename F> void OpenThermStateTable::read(F copy) const
+{
+  uint32_t before, after;
+  do {
+    before = this->sequence_.load(std::memory_order_acquire);
+    copy();
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = this->sequence_.load(std::memory_order_relaxed);
+  } while ((before & 1) || before != after);
+}
+
+OpenThermStateEntry OpenThermStateTable::get(uint8_t id) const
+{
+  OpenThermStateEntry entry;
+  this->read([&]() {
+    entry.value = this->values_[id];
+    entry.timestamp = this->timestamps_[id];
+    entry.status = this->statuses_[id];
+  });
+  return entry;
+}
+
+void OpenThermStateTable::get_all(uint16_t *values, uint32_t *timestamps, uint8_t *statuses) const
+{
+  this->read([&]() {
+    memcpy(values, this->values_, sizeof(this->values_));
+    memcpy(timestamps, this->timestamps_, sizeof(this->timestamps_));
+    memcpy(statuses, this->statuses_, sizeof(this->statuses_));
+  });
+}
+
+}  // namespace opentherm
+}  // namespace esphome
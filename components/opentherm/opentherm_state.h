@@ -0,0 +1,48 @@
+#pragma once
+/*
+Latest boiler response per data-ID, readable from any task.
+
+The table is a struct of arrays indexed by data-ID, written only by the
+protocol path. Readers never block the writer: the writer bumps a sequence
+counter to odd before and to even after an update, and a reader retries its
+copy when the counter was odd or changed while it was reading (a seqlock).
+*/
+
+#include <atomic>
+#include <cstdint>
+
+namespace esphome {
+namespace opentherm {
+
+struct OpenThermStateEntry {
+  uint16_t value;
+  uint32_t timestamp;  // millis() when the response was received
+  uint8_t status;      // message type of the response, NO_RESPONSE if never seen
+};
+
+class OpenThermStateTable {
+ public:
+  static const uint8_t NO_RESPONSE = 0xFF;
+
+  OpenThermStateTable();
+
+  // Writer side, protocol path only.
+  void update(uint32_t response, uint32_t now);
+
+  // Reader side, any task.
+  OpenThermStateEntry get(uint8_t id) const;
+  // Copy every data-ID at once; entries are consistent with each other.
+  void get_all(uint16_t *values, uint32_t *timestamps, uint8_t *statuses) const;
+  uint32_t updates() const { return this->sequence_.load(std::memory_order_acquire) / 2; }
+
+ protected:
+  template<typename F> void read(F copy) const;
+
+  std::atomic<uint32_t> sequence_{0};
+  uint16_t values_[256];
+  uint32_t timestamps_[256];
+  uint8_t statuses_[256];
+};
+
+}  // namespace opentherm
+}  // namespace esphome
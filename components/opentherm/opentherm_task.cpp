@@ -0,0 +1,98 @@
+#include "opentherm_task.h"
+#include "esphome/core/log.h"
+
+namespace esphome {
+namespace opentherm {
+
+#ifdef USE_ESP32
+static const char *TAG = "opentherm.task";
+
+// The ESPHome main loop runs on the application core as well; a higher
+// priority lets the protocol task preempt it whenever a frame needs handling.
+// Single-core variants (C3, C6, S2, H2) only have core 0.
+static const BaseType_t TASK_CORE = portNUM_PROCESSORS - 1;
+static const UBaseType_t TASK_PRIORITY = 5;
+static const uint32_t TASK_STACK_SIZE = 4096;
+
+bool OpenThermTask::start(void (*func)(void *), void *arg)
+{
+  if (xTaskCreatePinnedToCore(func, "opentherm", TASK_STACK_SIZE, arg, TASK_PRIORITY, &this->handle_, TASK_CORE) != pdPASS) {
+    ESP_LOGE(TAG, "Failed to create protocol task");
+    return false;
+  }
+  this->running_ = true;
+  return true;
+}
+
+void OpenThermTask::wait(uint32_t timeout_ms)
+{
+  ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(timeout_ms));
+}
+
+void OpenThermTask::notify()
+{
+  if (this->handle_ != nullptr)
+    xTaskNotifyGive(this->handle_);
+}
+
+void IRAM_ATTR OpenThermTask::notify_from_isr()
+{
+  if (this->handle_ == nullptr)
+    return;
+  BaseType_t woken = pdFALSE;
+  vTaskNotifyGiveFromISR(this->handle_, &woken);
+  portYIELD_FROM_ISR(woken);
+}
+
+#elif defined(USE_HOST)
+
+bool OpenThermTask::start(void (*func)(void *), void *arg)
+{
+  std::thread(func, arg).detach();
+  this->running_ = true;
+  return true;
+}
+
+void OpenThermTask::wait(uint32_t timeout_ms)
+{
+  std::unique_lock<std::mutex> lock(this->mutex_);
+  this->cv_.wait_for(lock, std::chrono::milliseconds(timeout_ms), [this] { return this->notified_; });
+  this->notified_ = false;
+}
+
+void OpenThermTask::notify()
+{
+  {
+    std::lock_guard<std::mutex> lock(this->mutex_);
+    this->notified_ = true;
+  }
+  this->cv_.notify_one();
+}
+
+void OpenThermTask::notify_from_isr()
+{
+  this->notify();
+}
+
+#else
+static const char *TAG = "opentherm.task";
+
+bool OpenThermTask::start(void (*func)(void *), void *arg)
+{
+  ESP_LOGW(TAG, "Protocol task is not supported on this platform, using the main loop");
+  return false;
+}
+
+void OpenThermTask::wait(uint32_t timeout_ms)
+{
+  delay(timeout_ms);
+}
+
+void OpenThermTask::notify() {}
+
+void IRAM_ATTR OpenThermTask::notify_from_isr() {}
+
+#endif
+
+}  // namespace opentherm
+}  // namespace esphome
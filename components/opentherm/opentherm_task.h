@@ -0,0 +1,88 @@
+#pragma once
+/*
+Dedicated protocol task for the OpenTherm gateway.
+
+On ESP32 the channel state machines and the relay pipeline can run in their own
+FreeRTOS task, pinned to the application core and woken by the input ISR through
+a task notification. On the host platform the same interface is backed by a
+std::thread so the concurrency can be exercised on Linux.
+
+The task and the ESPHome main loop only exchange data through single-producer,
+single-consumer lock-free queues.
+*/
+
+#include <atomic>
+#include <cstdint>
+#include "esphome/core/defines.h"
+#include "esphome/core/hal.h"
+
+#ifdef USE_ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#elif defined(USE_HOST)
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#endif
+
+namespace esphome {
+namespace opentherm {
+
+// Single-producer, single-consumer ring buffer. One slot is kept free to tell
+// an empty queue from a full one, so it holds at most N - 1 items.
+template<typename T, uint8_t N> class OpenThermQueue {
+ public:
+  bool push(const T &item) {
+    uint8_t head = this->head_.load(std::memory_order_relaxed);
+    uint8_t next = (head + 1) % N;
+    if (next == this->tail_.load(std::memory_order_acquire))
+      return false;
+    this->items_[head] = item;
+    this->head_.store(next, std::memory_order_release);
+    return true;
+  }
+
+  bool pop(T &item) {
+    uint8_t tail = this->tail_.load(std::memory_order_relaxed);
+    if (tail == this->head_.load(std::memory_order_acquire))
+      return false;
+    item = this->items_[tail];
+    this->tail_.store((tail + 1) % N, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const {
+    return this->tail_.load(std::memory_order_acquire) == this->head_.load(std::memory_order_acquire);
+  }
+
+ protected:
+  T items_[N];
+  std::atomic<uint8_t> head_{0};
+  std::atomic<uint8_t> tail_{0};
+};
+
+class OpenThermTask {
+ public:
+  // Start the task running func(arg) forever. Returns false when the platform
+  // has no task backend, in which case the caller keeps using loop().
+  bool start(void (*func)(void *), void *arg);
+  bool is_running() const { return this->running_; }
+
+  // Block the calling task until notified or timeout_ms has elapsed.
+  void wait(uint32_t timeout_ms);
+  void notify();
+  void notify_from_isr();
+
+ protected:
+#ifdef USE_ESP32
+  TaskHandle_t handle_{nullptr};
+#elif defined(USE_HOST)
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool notified_{false};
+#endif
+  bool running_{false};
+};
+
+}  // namespace opentherm
+}  // namespace esphome
@@ -0,0 +1,73 @@
+#include "opentherm_write_queue.h"
+#include "opentherm.h"
+
+namespace esphome {
+namespace opentherm {
+
+OpenThermWriteQueue::Slot *OpenThermWriteQueue::find(uint8_t id)
+{
+  uint8_t count = this->count_.load(std::memory_order_acquire);
+  for (uint8_t i = 0; i < count; i++) {
+    if (this->slots_[i].id == id)
+      return &this->slots_[i];
+  }
+  return nullptr;
+}
+
+bool OpenThermWriteQueue::write(uint8_t id, uint16_t data)
+{
+  Slot *slot = this->find(id);
+  if (slot == nullptr) {
+    uint8_t count = this->count_.load(std::memory_order_relaxed);
+    if (count == CAPACITY)
+      return false;
+    slot = &this->slots_[count];
+    slot->id = id;
+    this->count_.store(count + 1, std::memory_order_release);
+  }
+  slot->pending.store(buildRequest(OpenThermMessageType::WRITE_DATA, (OpenThermMessageID) id, data));
+  return true;
+}
+
+bool OpenThermWriteQueue::next(uint32_t &request)
+{
+  uint8_t count = this->count_.load(std::memory_order_acquire);
+  for (uint8_t n = 0; n < count; n++) {
+    Slot &slot = this->slots_[(this->next_ + n) % count];
+    request = slot.pending.exchange(0);
+    if (request != 0) {
+      this->next_ = (this->next_ + n + 1) % count;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool OpenThermWriteQueue::complete(uint32_t request, uint32_t response, bool success)
+{
+  Slot *slot = this->find(getDataID(request));
+  if (slot == nullptr)
+    return false;
+
+  if (success && getMessageType(response) == OpenThermMessageType::WRITE_ACK &&
+      getDataID(response) == getDataID(request)) {
+    slot->attempts = 0;
+    return true;
+  }
+
+  // The boiler explicitly rejected the value: retrying will not help.
+  bool rejected = success && (getMessageType(response) == OpenThermMessageType::DATA_INVALID ||
+                              getMessageType(response) == OpenThermMessageType::UNKNOWN_DATA_ID);
+  if (rejected || ++slot->attempts >= MAX_ATTEMPTS) {
+    slot->attempts = 0;
+    return false;
+  }
+
+  // Put the request back unless a newer value has been queued meanwhile.
+  uint32_t expected = 0;
+  slot->pending.compare_exchange_strong(expected, request);
+  return false;
+}
+
+}  // namespace opentherm
+}  // namespace esphome
@@ -0,0 +1,48 @@
+#pragma once
+/*
+Queue of WRITE_DATA requests the gateway sends to the boiler on its own.
+
+There is one slot per data-ID, so successive writes to the same data-ID
+coalesce and only the last value is sent. Slots are claimed and filled by the
+main loop and drained by the protocol path; the pending frame of each slot is
+a single atomic word, so neither side takes a lock. A write stays queued until
+the boiler confirms it with a WRITE_ACK, or until it has failed MAX_ATTEMPTS
+times.
+*/
+
+#include <atomic>
+#include <cstdint>
+
+namespace esphome {
+namespace opentherm {
+
+class OpenThermWriteQueue {
+ public:
+  static const uint8_t CAPACITY = 8;
+  static const uint8_t MAX_ATTEMPTS = 3;
+
+  // Main loop: queue a write, replacing any pending value for the same data-ID.
+  bool write(uint8_t id, uint16_t data);
+
+  // Protocol path: take the next pending write, round-robin over data-IDs.
+  bool next(uint32_t &request);
+  // Protocol path: report the boiler response to the request taken by next().
+  // Returns true when the write was confirmed.
+  bool complete(uint32_t request, uint32_t response, bool success);
+
+ protected:
+  struct Slot {
+    uint8_t id;
+    uint8_t attempts;
+    std::atomic<uint32_t> pending{0};  // 0: nothing to send, WRITE_DATA frames are never 0
+  };
+
+  Slot *find(uint8_t id);
+
+  Slot slots_[CAPACITY];
+  std::atomic<uint8_t> count_{0};
+  uint8_t next_{0};
+};
+
+}  // namespace opentherm
+}  // namespace esphome
@@ -0,0 +1,28 @@
+#pragma once
+// Host stand-in for the ESP-IDF 5 RMT transmit driver, for the tests in tools/.
+
+#include "rmt_rx.h"
+
+typedef struct {
+  gpio_num_t gpio_num;
+  rmt_clock_source_t clk_src;
+  uint32_t resolution_hz;
+  size_t mem_block_symbols;
+  size_t trans_queue_depth;
+  struct {
+    uint32_t invert_out : 1;
+  } flags;
+} rmt_tx_channel_config_t;
+
+typedef struct {
+} rmt_copy_encoder_config_t;
+
+typedef struct {
+  int loop_count;
+} rmt_transmit_config_t;
+
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *config, rmt_channel_handle_t *ret_chan);
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder);
+esp_err_t rmt_transmit(rmt_channel_handle_t tx_channel, rmt_encoder_handle_t encoder, const void *payload,
+                       size_t payload_bytes, const rmt_transmit_config_t *config);
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t tx_channel, int timeout_ms);
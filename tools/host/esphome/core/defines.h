@@ -0,0 +1,3 @@
+#pragma once
+// Host stand-in for the generated defines, for the tests in tools/.
+#define USE_HOST
@@ -0,0 +1,21 @@
+#pragma once
+// Host stand-in for esphome/core/gpio.h, for the tests in tools/. Pins are
+// only passed around, never driven.
+
+#include <cstdint>
+
+namespace esphome {
+
+class ISRInternalGPIOPin {
+ public:
+  bool digital_read() { return false; }
+  void clear_interrupt() {}
+};
+
+class InternalGPIOPin {
+ public:
+  virtual uint8_t get_pin() const = 0;
+  virtual bool is_inverted() const = 0;
+};
+
+}  // namespace esphome
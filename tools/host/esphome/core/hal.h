@@ -0,0 +1,22 @@
+#pragma once
+// Host stand-in for the parts of esphome/core/hal.h the component uses, for
+// the tests in tools/.
+
+#include <chrono>
+#include <cstdint>
+#include <thread>
+
+#define IRAM_ATTR
+
+namespace esphome {
+
+inline uint32_t micros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+inline uint32_t millis() { return micros() / 1000; }
+inline void delay(uint32_t ms) { std::this_thread::sleep_for(std::chrono::milliseconds(ms)); }
+inline void delayMicroseconds(uint32_t us) { std::this_thread::sleep_for(std::chrono::microseconds(us)); }
+inline void yield() { std::this_thread::yield(); }
+
+}  // namespace esphome
@@ -0,0 +1,274 @@
+/*
+Host test of the RMT receive path.
+
+Turns frames into the level/duration symbols the RMT receive channel would
+capture and runs them through OpenThermManchesterDecoder, then through
+OpenThermRmt::on_receive() with a fake rmt_rx_done_event_data_t to check which
+channel states accept a frame. Covers bit timing jitter, the low half of the
+stop bit merging with the idle line, and captures that must be rejected.
+
+The ESPHome core and RMT driver headers are replaced by the stand-ins in
+host/. Build and run on the host:
+
+  g++ -std=c++17 -O2 -pthread -DUSE_OPENTHERM_RMT -Ihost -I../components/opentherm ot_rmt_test.cpp \
+      ../components/opentherm/opentherm_rmt.cpp ../components/opentherm/opentherm_task.cpp -o ot_rmt_test
+  ./ot_rmt_test
+*/
+
+#include "opentherm.h"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+using namespace esphome::opentherm;
+
+// The receive path never talks to the driver; setup() and transmit() do.
+esp_err_t rmt_new_rx_channel(const rmt_rx_channel_config_t *, rmt_channel_handle_t *) { return ESP_FAIL; }
+esp_err_t rmt_rx_register_event_callbacks(rmt_channel_handle_t, const rmt_rx_event_callbacks_t *, void *) {
+  return ESP_FAIL;
+}
+esp_err_t rmt_enable(rmt_channel_handle_t) { return ESP_FAIL; }
+esp_err_t rmt_disable(rmt_channel_handle_t) { return ESP_FAIL; }
+esp_err_t rmt_receive(rmt_channel_handle_t, void *, size_t, const rmt_receive_config_t *) { return ESP_FAIL; }
+esp_err_t rmt_new_tx_channel(const rmt_tx_channel_config_t *, rmt_channel_handle_t *) { return ESP_FAIL; }
+esp_err_t rmt_new_copy_encoder(const rmt_copy_encoder_config_t *, rmt_encoder_handle_t *) { return ESP_FAIL; }
+esp_err_t rmt_transmit(rmt_channel_handle_t, rmt_encoder_handle_t, const void *, size_t,
+                       const rmt_transmit_config_t *) {
+  return ESP_FAIL;
+}
+esp_err_t rmt_tx_wait_all_done(rmt_channel_handle_t, int) { return ESP_FAIL; }
+
+class TestRmt : public OpenThermRmt {
+ public:
+  using OpenThermRmt::on_receive;
+  void attach(OpenThermStore *store) { this->store_ = store; }
+};
+
+struct Run {
+  bool level;
+  uint32_t duration_us;
+};
+
+static int failures = 0;
+
+#define CHECK(condition, ...) \
+  do { \
+    if (!(condition)) { \
+      failures++; \
+      printf("FAIL line %d: ", __LINE__); \
+      printf(__VA_ARGS__); \
+      printf("\n"); \
+    } \
+  } while (0)
+
+static uint32_t next_random(uint32_t &state) {
+  state ^= state << 13;
+  state ^= state >> 17;
+  state ^= state << 5;
+  return state;
+}
+
+// Level runs of the top count bits, 500 µs per half bit with every edge after
+// the first moved by up to +-jitter_us. The idle line after the last bit is
+// left out, so its second half is only there if stop_half is set.
+static std::vector<Run> encode_bits(uint64_t bits, int count, uint32_t jitter_us, uint32_t &state,
+                                    bool stop_half = true) {
+  std::vector<bool> halves;
+  for (int i = count - 1; i >= 0; i--) {
+    bool one = (bits >> i) & 1;
+    halves.push_back(one);
+    halves.push_back(!one);
+  }
+  if (!stop_half)
+    halves.pop_back();
+
+  // Nominal time of each level change and of the end of the last half.
+  std::vector<Run> runs;
+  std::vector<int32_t> edges{0};
+  for (size_t i = 1; i <= halves.size(); i++) {
+    if (i == halves.size() || halves[i] != halves[i - 1]) {
+      runs.push_back(Run{halves[i - 1], 0});
+      edges.push_back(i * 500);
+    }
+  }
+  for (size_t i = 1; i < edges.size(); i++) {
+    if (jitter_us > 0)
+      edges[i] += (int32_t)(next_random(state) % (2 * jitter_us + 1)) - (int32_t) jitter_us;
+    runs[i - 1].duration_us = edges[i] - edges[i - 1];
+  }
+  return runs;
+}
+
+// A frame with its start and stop bits.
+static std::vector<Run> encode(uint32_t frame, uint32_t jitter_us, uint32_t &state, bool stop_half = true) {
+  return encode_bits((1ULL << 33) | ((uint64_t) frame << 1) | 1, 34, jitter_us, state, stop_half);
+}
+
+// Pack runs into RMT symbols the way the receive channel reports them, ending
+// with a zero duration once the input stays idle.
+static std::vector<rmt_symbol_word_t> to_symbols(const std::vector<Run> &runs) {
+  std::vector<rmt_symbol_word_t> symbols;
+  for (size_t i = 0; i < runs.size(); i += 2) {
+    rmt_symbol_word_t symbol{};
+    symbol.level0 = runs[i].level;
+    symbol.duration0 = runs[i].duration_us;
+    if (i + 1 < runs.size()) {
+      symbol.level1 = runs[i + 1].level;
+      symbol.duration1 = runs[i + 1].duration_us;
+    }
+    symbols.push_back(symbol);
+  }
+  if (runs.size() % 2 == 0) {
+    rmt_symbol_word_t end{};
+    end.level0 = !runs.back().level;
+    symbols.push_back(end);
+  }
+  return symbols;
+}
+
+static bool decode(const std::vector<rmt_symbol_word_t> &symbols, uint32_t &frame) {
+  OpenThermManchesterDecoder decoder;
+  decoder.reset();
+  for (const rmt_symbol_word_t &symbol : symbols) {
+    decoder.feed(symbol.level0, symbol.duration0);
+    decoder.feed(symbol.level1, symbol.duration1);
+  }
+  return decoder.finish(frame);
+}
+
+static bool decode(const std::vector<Run> &runs, uint32_t &frame) { return decode(to_symbols(runs), frame); }
+
+static void test_valid_frames() {
+  uint32_t state = 0x9E3779B9;
+  for (uint32_t jitter_us : {0u, 60u, 120u}) {
+    for (int n = 0; n < 20000; n++) {
+      uint32_t frame = next_random(state);
+      bool stop_half = n % 2 == 0;
+      uint32_t decoded = 0;
+      bool ok = decode(encode(frame, jitter_us, state, stop_half), decoded);
+      CHECK(ok && decoded == frame, "frame %08X, jitter %u us, stop half %d: ok %d, decoded %08X", frame,
+            jitter_us, stop_half, ok, decoded);
+    }
+  }
+  // All ones and all zeros give the longest and shortest runs.
+  for (uint32_t frame : {0x00000000u, 0xFFFFFFFFu, 0x55555555u, 0xAAAAAAAAu}) {
+    uint32_t decoded = 0;
+    bool ok = decode(encode(frame, 0, state, false), decoded);
+    CHECK(ok && decoded == frame, "frame %08X: ok %d, decoded %08X", frame, ok, decoded);
+  }
+}
+
+static void test_invalid_captures() {
+  uint32_t state = 0x12345678;
+  uint32_t frame = 0x40012D00;
+  uint32_t decoded;
+
+  std::vector<Run> runs = encode(frame, 0, state);
+  runs.insert(runs.begin(), Run{false, 500});
+  CHECK(!decode(runs, decoded), "capture starting with the idle level");
+
+  runs = encode(frame, 0, state);
+  runs.resize(runs.size() - 4);
+  CHECK(!decode(runs, decoded), "truncated frame");
+
+  runs = encode(frame, 0, state);
+  runs[5].duration_us = 100;
+  CHECK(!decode(runs, decoded), "glitch shorter than a half bit");
+
+  runs = encode(frame, 0, state);
+  runs[5].duration_us = 1500;
+  CHECK(!decode(runs, decoded), "no transition in the middle of a bit");
+
+  runs = encode(frame, 0, state);
+  runs[5].duration_us += 800;
+  CHECK(!decode(runs, decoded), "run beyond two half bits");
+
+  runs = encode_bits((1ULL << 34) | ((uint64_t) frame << 2) | 3, 35, 0, state);
+  CHECK(!decode(runs, decoded), "one bit too many");
+
+  runs = encode_bits((1ULL << 33) | ((uint64_t) frame << 1), 34, 0, state);
+  CHECK(!decode(runs, decoded), "stop bit is a zero");
+
+  runs = encode_bits((uint64_t) frame << 1 | 1, 34, 0, state);
+  CHECK(!decode(runs, decoded), "start bit is a zero");
+}
+
+// Run a capture through on_receive() with the store in the given state.
+static OpenThermStatus receive(OpenThermStore &store, OpenThermStatus status,
+                               const std::vector<rmt_symbol_word_t> &symbols) {
+  TestRmt rmt;
+  rmt.attach(&store);
+  store.status = status;
+  store.pending = false;
+  store.response = 0;
+  std::vector<rmt_symbol_word_t> buffer(symbols);
+  rmt_rx_done_event_data_t event{buffer.data(), buffer.size()};
+  TestRmt::on_receive(nullptr, &event, &rmt);
+  CHECK(!rmt.is_armed(), "receiver still armed after a capture");
+  CHECK(store.pending, "capture not reported to loop()");
+  return store.status;
+}
+
+static void test_gating() {
+  uint32_t state = 0xCAFEBABE;
+  uint32_t frame = 0x80000200;
+  std::vector<rmt_symbol_word_t> symbols = to_symbols(encode(frame, 100, state, false));
+  std::vector<Run> broken = encode(frame, 0, state);
+  broken[7].duration_us = 1500;
+  std::vector<rmt_symbol_word_t> invalid = to_symbols(broken);
+
+  struct Case {
+    bool slave;
+    bool passive;
+    OpenThermStatus status;
+    bool accepted;
+    const char *name;
+  };
+  const Case cases[] = {
+      {false, false, OpenThermStatus::RESPONSE_WAITING, true, "waiting for a response"},
+      {true, false, OpenThermStatus::RESPONSE_WAITING, true, "slave waiting for a response"},
+      {false, false, OpenThermStatus::READY, true, "idle, facing the thermostat"},
+      {true, false, OpenThermStatus::READY, false, "idle slave, unsolicited frame"},
+      {true, true, OpenThermStatus::READY, true, "idle passive slave"},
+      {false, false, OpenThermStatus::DELAY, false, "inter-frame delay"},
+      {false, false, OpenThermStatus::REQUEST_SENDING, false, "own request being sent"},
+      {true, true, OpenThermStatus::NOT_INITIALIZED, false, "not set up"},
+  };
+  for (const Case &c : cases) {
+    OpenThermStore store(c.slave);
+    store.passive = c.passive;
+    OpenThermStatus status = receive(store, c.status, symbols);
+    if (c.accepted)
+      CHECK(status == OpenThermStatus::RESPONSE_READY && store.response == frame, "%s: status %d, response %08X",
+            c.name, status, (uint32_t) store.response);
+    else
+      CHECK(status == c.status && store.response == 0, "%s: status %d, response %08X", c.name, status,
+            (uint32_t) store.response);
+
+    status = receive(store, c.status, invalid);
+    CHECK(status == (c.accepted ? OpenThermStatus::RESPONSE_INVALID : c.status), "%s, invalid capture: status %d",
+          c.name, status);
+  }
+
+  // A completed capture wakes the protocol task.
+  OpenThermTask task;
+  OpenThermStore store(false);
+  store.task = &task;
+  auto start = std::chrono::steady_clock::now();
+  receive(store, OpenThermStatus::RESPONSE_WAITING, symbols);
+  task.wait(1000);
+  CHECK(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(500), "protocol task not notified");
+}
+
+int main() {
+  test_valid_frames();
+  test_invalid_captures();
+  test_gating();
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("All checks passed\n");
+  return 0;
+}
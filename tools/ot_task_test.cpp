@@ -0,0 +1,171 @@
+/*
+Host test of the protocol task primitives.
+
+Runs OpenThermQueue with a producer and a consumer thread and checks every
+item arrives once, in order and intact, including while the queue is full.
+Then starts an OpenThermTask on the std::thread backend and checks that
+notify() wakes wait() early, that a notification given before wait() is not
+lost, and that wait() returns after its timeout otherwise.
+
+The ESPHome core headers are replaced by the stand-ins in host/. Build and
+run on the host, preferably with -fsanitize=thread as well:
+
+  g++ -std=c++17 -O2 -pthread -Ihost -I../components/opentherm ot_task_test.cpp \
+      ../components/opentherm/opentherm_task.cpp -o ot_task_test
+  ./ot_task_test
+*/
+
+#include "opentherm_task.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+
+using namespace esphome::opentherm;
+using std::chrono::milliseconds;
+using std::chrono::steady_clock;
+
+static int failures = 0;
+
+#define CHECK(condition, ...) \
+  do { \
+    if (!(condition)) { \
+      failures++; \
+      printf("FAIL line %d: ", __LINE__); \
+      printf(__VA_ARGS__); \
+      printf("\n"); \
+    } \
+  } while (0)
+
+// Larger than a word so a torn copy shows up as a checksum mismatch.
+struct Item {
+  uint32_t sequence;
+  uint32_t payload[3];
+  uint32_t checksum;
+};
+
+static Item make_item(uint32_t sequence) {
+  Item item{sequence, {sequence * 3, ~sequence, sequence ^ 0xA5A5A5A5}, 0};
+  item.checksum = item.sequence ^ item.payload[0] ^ item.payload[1] ^ item.payload[2];
+  return item;
+}
+
+static void test_queue_single_thread() {
+  OpenThermQueue<Item, 8> queue;
+  Item item;
+  CHECK(queue.empty() && !queue.pop(item), "new queue not empty");
+  for (uint32_t i = 0; i < 7; i++)
+    CHECK(queue.push(make_item(i)), "push %u into a queue of 7 failed", i);
+  CHECK(!queue.push(make_item(7)), "queue holds more than N - 1 items");
+  for (uint32_t i = 0; i < 7; i++)
+    CHECK(queue.pop(item) && item.sequence == i, "pop %u returned %u", i, item.sequence);
+  CHECK(queue.empty() && !queue.pop(item), "drained queue not empty");
+}
+
+static void test_queue_threads() {
+  static const uint32_t COUNT = 2000000;
+  OpenThermQueue<Item, 16> queue;
+  std::atomic<uint32_t> full{0};
+
+  std::thread producer([&] {
+    for (uint32_t i = 0; i < COUNT; i++) {
+      while (!queue.push(make_item(i))) {
+        full.fetch_add(1, std::memory_order_relaxed);
+        std::this_thread::yield();
+      }
+    }
+  });
+
+  uint32_t expected = 0;
+  uint32_t bad = 0;
+  Item item;
+  while (expected < COUNT) {
+    if (!queue.pop(item)) {
+      std::this_thread::yield();
+      continue;
+    }
+    if (item.sequence != expected || item.checksum != make_item(expected).checksum ||
+        item.payload[1] != ~expected)
+      bad++;
+    expected = item.sequence + 1;
+  }
+  producer.join();
+
+  CHECK(bad == 0, "%u items out of order or torn", bad);
+  CHECK(queue.empty(), "queue not empty after the last item");
+  // Only meaningful if the producer actually ran into a full queue.
+  printf("queue: %u items, producer found the queue full %u times\n", COUNT, full.load());
+}
+
+struct TaskState {
+  OpenThermTask task;
+  std::atomic<uint32_t> wakeups{0};
+  std::atomic<bool> stop{false};
+  std::atomic<uint32_t> stopped{0};
+};
+
+static void task_body(void *arg) {
+  auto *state = static_cast<TaskState *>(arg);
+  while (!state->stop.load()) {
+    state->task.wait(10000);
+    state->wakeups.fetch_add(1);
+  }
+  state->stopped = 1;
+}
+
+static bool wait_for(const std::atomic<uint32_t> &value, uint32_t expected, milliseconds timeout) {
+  auto deadline = steady_clock::now() + timeout;
+  while (value.load() < expected) {
+    if (steady_clock::now() > deadline)
+      return false;
+    std::this_thread::sleep_for(milliseconds(1));
+  }
+  return true;
+}
+
+static void test_task() {
+  // The task thread is detached, it is stopped before the state goes away.
+  TaskState state;
+  CHECK(state.task.start(task_body, &state) && state.task.is_running(), "task did not start");
+
+  // Each notification ends one 10 s wait well before its timeout.
+  for (uint32_t i = 1; i <= 100; i++) {
+    auto start = steady_clock::now();
+    state.task.notify();
+    CHECK(wait_for(state.wakeups, i, milliseconds(1000)), "notification %u not delivered", i);
+    CHECK(steady_clock::now() - start < milliseconds(1000), "wakeup %u took too long", i);
+  }
+  state.task.notify_from_isr();
+  CHECK(wait_for(state.wakeups, 101, milliseconds(1000)), "notify_from_isr() not delivered");
+
+  // A notification given while nobody waits is kept for the next wait().
+  OpenThermTask task;
+  task.notify();
+  auto start = steady_clock::now();
+  task.wait(5000);
+  CHECK(steady_clock::now() - start < milliseconds(1000), "early notification lost");
+
+  // Taken by that wait, so the next one runs into its timeout.
+  start = steady_clock::now();
+  task.wait(50);
+  auto elapsed = steady_clock::now() - start;
+  CHECK(elapsed >= milliseconds(50) && elapsed < milliseconds(1000), "wait(50) took %lld ms",
+        (long long) std::chrono::duration_cast<milliseconds>(elapsed).count());
+
+  state.stop = true;
+  state.task.notify();
+  CHECK(wait_for(state.stopped, 1, milliseconds(1000)), "task did not stop");
+}
+
+int main() {
+  test_queue_single_thread();
+  test_queue_threads();
+  test_task();
+  if (failures > 0) {
+    printf("%d checks failed\n", failures);
+    return 1;
+  }
+  printf("All checks passed\n");
+  return 0;
+}
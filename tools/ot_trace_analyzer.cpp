@@ -0,0 +1,439 @@
+/*
+Offline OpenTherm trace analyzer.
+
+Reads trace files with one frame per line in OpenTherm Gateway format, e.g.
+
+  12:34:56.789012  T80000200
+  12:34:56.912345  B40000300
+  1234567 R10012D00
+
+The first token is an optional timestamp, either HH:MM:SS[.ffffff] or a plain
+number of milliseconds. The frame is the first token of a source letter (T, B,
+R or A) followed by eight hex digits; other lines are ignored. Files are
+memory-mapped and split into chunks that are decoded in parallel, then per
+data-ID statistics are printed: request and response counts, error responses,
+response latency, polling interval and the distribution of the values (range,
+mean and standard deviation). Response latency pairs split across a chunk
+boundary are not counted.
+
+Build on the host with the component's own codec:
+
+  g++ -std=c++17 -O2 -pthread -I../components/opentherm ot_trace_analyzer.cpp \
+      ../components/opentherm/opentherm_frame.cpp -o ot_trace_analyzer
+
+Usage:
+
+  ot_trace_analyzer [-j threads] [-i id]... [-s sources] [-o export.csv] trace...
+
+  -j  number of worker threads, defaults to the number of cores
+  -i  only report and export this data-ID, may be repeated
+  -s  only export frames from these sources, e.g. "TB"
+  -o  write matching frames as CSV: file,timestamp_ms,source,type,id,value
+*/
+
+#include "opentherm_frame.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+using namespace esphome::opentherm;
+
+static const int64_t NO_TIME = INT64_MIN;
+static const size_t MIN_CHUNK = 8 << 20;
+
+struct Range {
+  uint64_t count{0};
+  double sum{0};
+  double sum_sq{0};
+  double min{INFINITY};
+  double max{-INFINITY};
+
+  void add(double value) {
+    this->count++;
+    this->sum += value;
+    this->sum_sq += value * value;
+    this->min = std::min(this->min, value);
+    this->max = std::max(this->max, value);
+  }
+  void merge(const Range &other) {
+    this->count += other.count;
+    this->sum += other.sum;
+    this->sum_sq += other.sum_sq;
+    this->min = std::min(this->min, other.min);
+    this->max = std::max(this->max, other.max);
+  }
+  double mean() const { return this->count ? this->sum / this->count : 0; }
+  double stddev() const {
+    if (this->count < 2)
+      return 0;
+    double mean = this->mean();
+    return std::sqrt(std::max(0.0, this->sum_sq / this->count - mean * mean));
+  }
+};
+
+struct IdStats {
+  uint64_t requests{0};
+  uint64_t responses{0};
+  uint64_t types[8]{};
+  Range values;
+  Range latency_ms;
+  Range interval_s;
+
+  void merge(const IdStats &other) {
+    this->requests += other.requests;
+    this->responses += other.responses;
+    for (int i = 0; i < 8; i++)
+      this->types[i] += other.types[i];
+    this->values.merge(other.values);
+    this->latency_ms.merge(other.latency_ms);
+    this->interval_s.merge(other.interval_s);
+  }
+};
+
+struct Chunk {
+  size_t file;
+  const char *begin;
+  const char *end;
+};
+
+// Result of one chunk. The first and last request times per data-ID let
+// polling intervals be joined across chunks of the same file.
+struct Partial {
+  IdStats ids[256];
+  int64_t first_request_us[256];
+  int64_t last_request_us[256];
+  uint64_t lines{0};
+  uint64_t frames{0};
+  uint64_t parity_errors{0};
+  std::string exported;
+};
+
+struct Options {
+  unsigned threads{std::max(1u, std::thread::hardware_concurrency())};
+  bool id_filter[256]{};
+  bool has_id_filter{false};
+  std::string sources{"TBRA"};
+  const char *export_path{nullptr};
+  std::vector<const char *> files;
+};
+
+static int hex_digit(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  return -1;
+}
+
+// Timestamp in microseconds from the first token of a line, NO_TIME if absent.
+static int64_t parse_time(const char *p, const char *end) {
+  int64_t fields[3] = {0, 0, 0};
+  int field = 0;
+  const char *start = p;
+  while (p < end && *p >= '0' && *p <= '9') {
+    fields[field] = fields[field] * 10 + (*p - '0');
+    p++;
+    if (p < end && *p == ':' && field < 2) {
+      field++;
+      p++;
+    }
+  }
+  if (p == start)
+    return NO_TIME;
+  if (field == 0)
+    return fields[0] * 1000;  // plain milliseconds
+
+  int64_t us = ((fields[0] * 60 + fields[1]) * 60 + fields[2]) * 1000000;
+  if (p < end && *p == '.') {
+    p++;
+    int64_t scale = 100000;
+    for (; p < end && *p >= '0' && *p <= '9'; p++, scale /= 10)
+      us += (*p - '0') * scale;
+  }
+  return us;
+}
+
+// Find "<source><8 hex digits>" as a whole token.
+static bool parse_frame(const char *p, const char *end, char &source, uint32_t &frame) {
+  for (; p + 9 <= end; p++) {
+    if (*p != 'T' && *p != 'B' && *p != 'R' && *p != 'A')
+      continue;
+    if (p + 9 < end && hex_digit(p[9]) >= 0)
+      continue;
+    uint32_t value = 0;
+    int i = 1;
+    for (; i <= 8; i++) {
+      int digit = hex_digit(p[i]);
+      if (digit < 0)
+        break;
+      value = (value << 4) | digit;
+    }
+    if (i == 9) {
+      source = *p;
+      frame = value;
+      return true;
+    }
+  }
+  return false;
+}
+
+static void analyze(const Chunk &chunk, const Options &options, const std::vector<std::string> &names,
+                    Partial &result) {
+  std::fill(std::begin(result.first_request_us), std::end(result.first_request_us), NO_TIME);
+  std::fill(std::begin(result.last_request_us), std::end(result.last_request_us), NO_TIME);
+  int64_t pending_us[256];
+  std::fill(std::begin(pending_us), std::end(pending_us), NO_TIME);
+
+  for (const char *line = chunk.begin; line < chunk.end;) {
+    const char *eol = static_cast<const char *>(memchr(line, '\n', chunk.end - line));
+    if (eol == nullptr)
+      eol = chunk.end;
+    result.lines++;
+
+    char source;
+    uint32_t raw;
+    if (parse_frame(line, eol, source, raw)) {
+      OpenThermFrame frame(raw);
+      int64_t time = parse_time(line, eol);
+      if (!frame.parity_ok()) {
+        result.parity_errors++;
+      } else {
+        result.frames++;
+        uint8_t id = frame.id();
+        IdStats &stats = result.ids[id];
+        stats.types[frame.type()]++;
+        bool request = source == 'T' || source == 'R';
+        if (request) {
+          stats.requests++;
+          if (time != NO_TIME) {
+            if (result.last_request_us[id] != NO_TIME && time > result.last_request_us[id])
+              stats.interval_s.add((time - result.last_request_us[id]) / 1e6);
+            if (result.first_request_us[id] == NO_TIME)
+              result.first_request_us[id] = time;
+            result.last_request_us[id] = time;
+          }
+          pending_us[id] = time;
+        } else {
+          stats.responses++;
+          if (time != NO_TIME && pending_us[id] != NO_TIME && time >= pending_us[id])
+            stats.latency_ms.add((time - pending_us[id]) / 1e3);
+          pending_us[id] = NO_TIME;
+        }
+
+        // Values carried by write requests and read acknowledgements.
+        if (frame.type() == WRITE_DATA || frame.type() == READ_ACK) {
+          const OpenThermMessageInfo *info = getMessageInfo(id);
+          if (info != nullptr && info->type == F88)
+            stats.values.add(frame.f88());
+          else if (info != nullptr && info->type == S16)
+            stats.values.add(frame.s16());
+          else if (info != nullptr && info->type == U16)
+            stats.values.add(frame.value());
+        }
+
+        if (options.export_path != nullptr && options.sources.find(source) != std::string::npos &&
+            (!options.has_id_filter || options.id_filter[id])) {
+          char value[32];
+          formatValue(value, sizeof(value), raw);
+          char row[160];
+          int len = snprintf(row, sizeof(row), "%s,%.3f,%c,%s,%u,%s\n", names[chunk.file].c_str(),
+                             time == NO_TIME ? NAN : time / 1e3, source, messageTypeToString(frame.type()), id,
+                             value);
+          result.exported.append(row, std::min<size_t>(len, sizeof(row) - 1));
+        }
+      }
+    }
+    line = eol + 1;
+  }
+}
+
+static bool map_file(const char *path, const char *&data, size_t &size) {
+  int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror(path);
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    perror(path);
+    close(fd);
+    return false;
+  }
+  size = st.st_size;
+  data = nullptr;
+  if (size > 0) {
+    void *mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapped == MAP_FAILED) {
+      perror(path);
+      close(fd);
+      return false;
+    }
+    madvise(mapped, size, MADV_SEQUENTIAL);
+    data = static_cast<const char *>(mapped);
+  }
+  close(fd);
+  return true;
+}
+
+static void usage(const char *program) {
+  fprintf(stderr, "usage: %s [-j threads] [-i id]... [-s sources] [-o export.csv] trace...\n", program);
+  exit(2);
+}
+
+int main(int argc, char **argv) {
+  Options options;
+  int opt;
+  while ((opt = getopt(argc, argv, "j:i:s:o:")) != -1) {
+    switch (opt) {
+      case 'j':
+        options.threads = std::max(1, atoi(optarg));
+        break;
+      case 'i': {
+        int id = atoi(optarg);
+        if (id < 0 || id > 255)
+          usage(argv[0]);
+        options.id_filter[id] = true;
+        options.has_id_filter = true;
+        break;
+      }
+      case 's':
+        options.sources = optarg;
+        break;
+      case 'o':
+        options.export_path = optarg;
+        break;
+      default:
+        usage(argv[0]);
+    }
+  }
+  for (int i = optind; i < argc; i++)
+    options.files.push_back(argv[i]);
+  if (options.files.empty())
+    usage(argv[0]);
+
+  // Split every file into chunks on line boundaries.
+  std::vector<std::string> names;
+  std::vector<std::pair<const char *, size_t>> maps;
+  std::vector<Chunk> chunks;
+  size_t total = 0;
+  for (const char *path : options.files) {
+    const char *data;
+    size_t size;
+    if (!map_file(path, data, size))
+      return 1;
+    names.push_back(path);
+    maps.emplace_back(data, size);
+    total += size;
+  }
+  size_t chunk_size = std::max(MIN_CHUNK, total / (options.threads * 4) + 1);
+  for (size_t f = 0; f < maps.size(); f++) {
+    const char *p = maps[f].first;
+    const char *end = p + maps[f].second;
+    while (p < end) {
+      const char *split = p + std::min(chunk_size, (size_t)(end - p));
+      if (split < end) {
+        const char *eol = static_cast<const char *>(memchr(split, '\n', end - split));
+        split = eol != nullptr ? eol + 1 : end;
+      }
+      chunks.push_back(Chunk{f, p, split});
+      p = split;
+    }
+  }
+
+  std::vector<Partial> partials(chunks.size());
+  std::atomic<size_t> next{0};
+  std::vector<std::thread> workers;
+  for (unsigned t = 0; t < std::min<size_t>(options.threads, chunks.size()); t++) {
+    workers.emplace_back([&]() {
+      for (size_t i = next++; i < chunks.size(); i = next++)
+        analyze(chunks[i], options, names, partials[i]);
+    });
+  }
+  for (std::thread &worker : workers)
+    worker.join();
+
+  // Merge in file order, joining polling intervals across chunk boundaries.
+  IdStats ids[256];
+  uint64_t lines = 0, frames = 0, parity_errors = 0;
+  int64_t last_request_us[256];
+  FILE *out = nullptr;
+  if (options.export_path != nullptr) {
+    out = fopen(options.export_path, "w");
+    if (out == nullptr) {
+      perror(options.export_path);
+      return 1;
+    }
+    fputs("file,timestamp_ms,source,type,id,value\n", out);
+  }
+  for (size_t i = 0; i < chunks.size(); i++) {
+    const Partial &partial = partials[i];
+    if (i == 0 || chunks[i].file != chunks[i - 1].file)
+      std::fill(std::begin(last_request_us), std::end(last_request_us), NO_TIME);
+    for (int id = 0; id < 256; id++) {
+      ids[id].merge(partial.ids[id]);
+      if (last_request_us[id] != NO_TIME && partial.first_request_us[id] != NO_TIME &&
+          partial.first_request_us[id] > last_request_us[id])
+        ids[id].interval_s.add((partial.first_request_us[id] - last_request_us[id]) / 1e6);
+      if (partial.last_request_us[id] != NO_TIME)
+        last_request_us[id] = partial.last_request_us[id];
+    }
+    lines += partial.lines;
+    frames += partial.frames;
+    parity_errors += partial.parity_errors;
+    if (out != nullptr)
+      fwrite(partial.exported.data(), 1, partial.exported.size(), out);
+  }
+  if (out != nullptr)
+    fclose(out);
+  for (auto &map : maps) {
+    if (map.second > 0)
+      munmap(const_cast<char *>(map.first), map.second);
+  }
+
+  printf("%zu files, %.1f MiB, %zu chunks, %u threads\n", maps.size(), total / 1048576.0, chunks.size(),
+         (unsigned) workers.size());
+  printf("%llu lines, %llu frames, %llu parity errors\n\n", (unsigned long long) lines,
+         (unsigned long long) frames, (unsigned long long) parity_errors);
+  printf("%3s %-26s %10s %10s %7s %7s %9s %9s %9s %9s %9s %9s %9s %9s\n", "ID", "NAME", "REQUESTS", "RESPONSES",
+         "INV%", "UNK%", "LAT_MS", "LAT_MAX", "POLL_S", "POLL_MAX", "MIN", "MEAN", "MAX", "STDDEV");
+  for (int id = 0; id < 256; id++) {
+    const IdStats &stats = ids[id];
+    if (stats.requests == 0 && stats.responses == 0)
+      continue;
+    if (options.has_id_filter && !options.id_filter[id])
+      continue;
+    const OpenThermMessageInfo *info = getMessageInfo(id);
+    double responses = stats.responses ? stats.responses : 1;
+    printf("%3d %-26s %10llu %10llu %7.2f %7.2f", id, info != nullptr ? info->name : "?",
+           (unsigned long long) stats.requests, (unsigned long long) stats.responses,
+           100.0 * stats.types[DATA_INVALID] / responses, 100.0 * stats.types[UNKNOWN_DATA_ID] / responses);
+    if (stats.latency_ms.count)
+      printf(" %9.1f %9.1f", stats.latency_ms.mean(), stats.latency_ms.max);
+    else
+      printf(" %9s %9s", "-", "-");
+    if (stats.interval_s.count)
+      printf(" %9.2f %9.2f", stats.interval_s.mean(), stats.interval_s.max);
+    else
+      printf(" %9s %9s", "-", "-");
+    if (stats.values.count)
+      printf(" %9.2f %9.2f %9.2f %9.2f\n", stats.values.min, stats.values.mean(), stats.values.max,
+             stats.values.stddev());
+    else
+      printf(" %9s %9s %9s %9s\n", "-", "-", "-", "-");
+  }
+  return 0;
+}